@@ -0,0 +1,212 @@
+//
+// alloc_stats.cpp
+// ~~~~~~~~~~~~~~~
+//
+// Replacement of the global operator new/delete counting the allocations per thread and per tag (alloc_stats.h).
+// Linked into the benchmarks by the CMake option GOR_ALLOC_STATS.
+//
+
+#include <alloc_stats.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#if !defined(GOR_ALLOC_STATS)
+#error "alloc_stats.cpp requires GOR_ALLOC_STATS"
+#endif
+
+namespace
+{
+
+// Counters of a thread. Only the owner thread writes them (no locked instructions), alloc_snapshot() reads them from
+// any thread. The live counters are linked in a list, a finished thread adds its counts to the retired totals.
+struct thread_counters
+{
+    std::array<std::atomic<std::uint64_t>, alloc_tags> allocations{};
+    std::array<std::atomic<std::uint64_t>, alloc_tags> bytes{};
+    thread_counters* next = nullptr;
+    thread_counters* previous = nullptr;
+
+    thread_counters();
+    ~thread_counters();
+
+    void add_to(alloc_totals& totals) const
+    {
+        for (std::size_t i = 0; i < alloc_tags; ++i)
+        {
+            totals.allocations[i] += allocations[i].load(std::memory_order_relaxed);
+            totals.bytes[i] += bytes[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+// constant initialized: usable by the allocations of the static constructors
+std::mutex registry_mutex;
+thread_counters* live_threads = nullptr;
+alloc_totals retired_threads;
+
+thread_counters::thread_counters()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    next = live_threads;
+    if (next)
+        next->previous = this;
+    live_threads = this;
+}
+
+thread_counters::~thread_counters()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    add_to(retired_threads);
+
+    if (previous)
+        previous->next = next;
+    else
+        live_threads = next;
+    if (next)
+        next->previous = previous;
+}
+
+// constructing the counters doesn't allocate
+thread_local thread_counters counters;
+
+void count(std::size_t size) noexcept
+{
+    auto tag = current_alloc_tag;
+    auto& allocations = counters.allocations[tag];
+    auto& bytes = counters.bytes[tag];
+    allocations.store(allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    bytes.store(bytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+}
+
+void* try_allocate(std::size_t size, std::size_t alignment) noexcept
+{
+    if (size == 0)
+        size = 1;
+
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return std::malloc(size);
+
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    // aligned_alloc wants a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+void release(void* pointer, std::size_t alignment) noexcept
+{
+#if defined(_MSC_VER)
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return _aligned_free(pointer);
+#else
+    (void)alignment;
+#endif
+    std::free(pointer);
+}
+
+void* allocate(std::size_t size, std::size_t alignment)
+{
+    count(size);
+
+    for (;;)
+    {
+        if (void* pointer = try_allocate(size, alignment))
+            return pointer;
+
+        auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* allocate(std::size_t size, std::size_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+constexpr std::size_t default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+} // namespace
+
+alloc_totals alloc_snapshot()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    alloc_totals totals = retired_threads;
+    for (auto thread = live_threads; thread; thread = thread->next)
+        thread->add_to(totals);
+
+    return totals;
+}
+
+void* operator new(std::size_t size) { return allocate(size, default_alignment); }
+void* operator new[](std::size_t size) { return allocate(size, default_alignment); }
+void* operator new(std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return allocate(size, default_alignment, tag);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return allocate(size, default_alignment, tag);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment), tag);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment), tag);
+}
+
+void operator delete(void* pointer) noexcept { release(pointer, default_alignment); }
+void operator delete[](void* pointer) noexcept { release(pointer, default_alignment); }
+void operator delete(void* pointer, std::size_t) noexcept { release(pointer, default_alignment); }
+void operator delete[](void* pointer, std::size_t) noexcept { release(pointer, default_alignment); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { release(pointer, default_alignment); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { release(pointer, default_alignment); }
+
+void operator delete(void* pointer, std::align_val_t alignment) noexcept
+{
+    release(pointer, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept
+{
+    release(pointer, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    release(pointer, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    release(pointer, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    release(pointer, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    release(pointer, static_cast<std::size_t>(alignment));
+}
@@ -0,0 +1,269 @@
+//
+// c100k_bench.cpp
+// ~~~~~~~~~~~~~~~
+//
+// Many-connection harness: starts a server as a child process and opens <connections> loopback connections to
+// it, bound in turn to the source addresses 127.0.0.1 .. 127.0.0.<sources> (a source address has about 28k
+// ephemeral ports towards one server port). Every connection makes one round trip once connected, so the server
+// has accepted it and started its session; the latency of that first round trip includes the wait in the accept
+// backlog. Then <active> connections, spread over the others, run round trips for <time> seconds while the rest stay
+// idle with a read pending in the server.
+// Reported: the connection rate and latencies, the resident memory per connection of the server (and of the
+// harness), the CPU time of the server and the round trip latency of the active connections.
+// The harness runs on one io thread and raises its open files limit to the hard limit, which the server inherits.
+// Linux only (/proc).
+//
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include <asio.hpp>
+#include <asio/system_timer.hpp>
+
+#include <asio_future_await.h>
+#include <await_adapters.h>
+#include <busy_poll.h>
+#include <child_process.h>
+#include <descriptor_limit.h>
+#include <future_adapter.h>
+#include <latency_histogram.h>
+
+// connections being established at the same time, below the listen backlog of the servers
+constexpr size_t connect_window = 256;
+
+struct connect_stats
+{
+    size_t connected = 0;
+    size_t failed = 0;
+    latency_histogram connects;           // connect() until connected
+    latency_histogram first_round_trips;  // includes the wait in the accept backlog of the server
+};
+
+std::future<void>
+connector(std::vector<asio::ip::tcp::socket>& sockets,
+          size_t& next,
+          const asio::ip::tcp::endpoint& server,
+          const size_t sources,
+          const size_t block_size,
+          connect_stats& stats)
+{
+    std::vector<char> data(block_size);
+
+    // the connectors share next: they all run on the io thread
+    while (next < sockets.size())
+    {
+        size_t index = next++;
+        auto& socket = sockets[index];
+
+        try
+        {
+            asio::ip::address_v4::bytes_type source{{127, 0, 0, static_cast<unsigned char>(1 + index % sources)}};
+            socket.open(asio::ip::tcp::v4());
+            socket.bind(asio::ip::tcp::endpoint(asio::ip::address_v4(source), 0));
+
+            auto start = std::chrono::steady_clock::now();
+            co_await async_connect(socket, server);
+            stats.connects.record(std::chrono::steady_clock::now() - start);
+            socket.set_option(asio::ip::tcp::no_delay(true));
+
+            start = std::chrono::steady_clock::now();
+            co_await async_write(socket, asio::buffer(data));
+            co_await async_read_some(socket, asio::buffer(data));
+            stats.first_round_trips.record(std::chrono::steady_clock::now() - start);
+            ++stats.connected;
+        }
+        catch (std::exception& e)
+        {
+            if (stats.failed++ == 0)
+                std::cerr << "Exception: " << e.what() << std::endl;
+            socket.close();
+        }
+    }
+}
+
+std::future<void>
+active_session(asio::ip::tcp::socket& socket,
+               const size_t block_size,
+               latency_histogram& round_trips,
+               std::stop_token stop)
+{
+    std::vector<char> data(block_size);
+
+    try
+    {
+        while (!stop.stop_requested())
+        {
+            auto start = std::chrono::steady_clock::now();
+            co_await async_write(socket, asio::buffer(data));
+            co_await async_read_some(socket, asio::buffer(data));
+            round_trips.record(std::chrono::steady_clock::now() - start);
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (e.code() != asio::error::operation_aborted)
+            std::cerr << "Exception: " << e.what() << std::endl;
+    }
+}
+
+std::future<void>
+bench(asio::io_service& ios,
+      const child& server,
+      const asio::ip::tcp::endpoint endpoint,
+      const size_t block_size,
+      const size_t connections,
+      const size_t active,
+      const size_t sources,
+      const int timeout)
+{
+    auto mb = [](double bytes) { return bytes / (1024 * 1024); };
+    auto server_rss = server.resident_bytes();
+    auto client_rss = process_resident_bytes(::getpid());
+
+    // Connect
+    std::vector<asio::ip::tcp::socket> sockets;
+    sockets.reserve(connections);
+    for (size_t i = 0; i < connections; ++i)
+        sockets.emplace_back(ios);
+
+    connect_stats stats;
+    size_t next = 0;
+    std::list<std::future<void>> connectors;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < std::min(connect_window, connections); ++i)
+        connectors.push_back(connector(sockets, next, endpoint, sources, block_size, stats));
+    while (!connectors.empty())
+    {
+        co_await asio_future_awaiter(ios, std::move(connectors.front()));
+        connectors.pop_front();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << stats.connected << " connections from " << sources << " source addresses in " << elapsed.count()
+              << " s, " << static_cast<double>(stats.connected) / elapsed.count() << " connections/s, "
+              << stats.failed << " failed" << std::endl;
+    std::cout << "connect latency: " << stats.connects << std::endl;
+    std::cout << "first round trip latency: " << stats.first_round_trips << std::endl;
+
+    if (stats.connected == 0)
+        co_return;
+
+    auto per_connection = [&](std::size_t before, std::size_t after)
+    {
+        return after > before ? static_cast<double>(after - before) / static_cast<double>(stats.connected) : 0.0;
+    };
+    auto server_connected_rss = server.resident_bytes();
+    auto client_connected_rss = process_resident_bytes(::getpid());
+    std::cout << "server rss " << mb(static_cast<double>(server_rss)) << " MB idle, "
+              << mb(static_cast<double>(server_connected_rss)) << " MB connected, "
+              << per_connection(server_rss, server_connected_rss) << " bytes/connection" << std::endl;
+    std::cout << "client rss " << mb(static_cast<double>(client_rss)) << " MB idle, "
+              << mb(static_cast<double>(client_connected_rss)) << " MB connected, "
+              << per_connection(client_rss, client_connected_rss) << " bytes/connection" << std::endl;
+
+    // Run the active connections, spread over the open ones
+    std::vector<asio::ip::tcp::socket*> open;
+    for (auto& socket : sockets)
+        if (socket.is_open())
+            open.push_back(&socket);
+
+    size_t active_count = std::min(active, open.size());
+    std::stop_source stop;
+    latency_histogram round_trips;
+    std::list<std::future<void>> sessions;
+    for (size_t i = 0; i < active_count; ++i)
+        sessions.push_back(active_session(*open[i * open.size() / active_count], block_size, round_trips,
+                                          stop.get_token()));
+
+    auto server_cpu = server.cpu_seconds();
+    auto client_cpu = cpu_seconds();
+    start = std::chrono::steady_clock::now();
+
+    asio::system_timer stop_timer(ios);
+    co_await async_wait(stop_timer, std::chrono::seconds(timeout));
+
+    elapsed = std::chrono::steady_clock::now() - start;
+    server_cpu = server.cpu_seconds() - server_cpu;
+    client_cpu = cpu_seconds() - client_cpu;
+
+    stop.request_stop();
+    while (!sessions.empty())
+    {
+        co_await asio_future_awaiter(ios, std::move(sessions.front()));
+        sessions.pop_front();
+    }
+
+    auto us_per_round_trip = [&](double cpu)
+    {
+        return round_trips.count() ? cpu * 1e6 / static_cast<double>(round_trips.count()) : 0.0;
+    };
+    std::cout << active_count << " active connections: "
+              << static_cast<double>(round_trips.count()) / elapsed.count() << " round trips/s" << std::endl;
+    std::cout << "round trip latency: " << round_trips << std::endl;
+    std::cout << "server cpu " << server_cpu << " s in " << elapsed.count() << " s, "
+              << us_per_round_trip(server_cpu) << " us/round trip" << std::endl;
+    std::cout << "client cpu " << client_cpu << " s in " << elapsed.count() << " s, "
+              << us_per_round_trip(client_cpu) << " us/round trip" << std::endl;
+
+    // Close the connections
+    for (auto& socket : sockets)
+        socket.close();
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc < 8)
+        {
+            std::cerr << "Usage: c100k_bench <port> <blocksize> <connections> <active> <sources> <time> "
+                      << "<server command line...>" << std::endl;
+            return 1;
+        }
+
+        using namespace std; // For atoi.
+        auto port = static_cast<unsigned short>(atoi(argv[1]));
+        size_t block_size = atoi(argv[2]);
+        size_t connections = atoi(argv[3]);
+        size_t active = atoi(argv[4]);
+        size_t sources = std::clamp(atoi(argv[5]), 1, 254);
+        int timeout = atoi(argv[6]);
+        std::vector<std::string> server_args(argv + 7, argv + argc);
+
+        // a descriptor per connection on both sides: the server inherits the limit
+        connections = raise_descriptor_limit(connections, 1);
+
+        std::string server_output = "/tmp/c100k_bench_server." + std::to_string(::getpid());
+        child server(server_args, server_output);
+        if (!wait_listening(server, "127.0.0.1", port))
+        {
+            std::cerr << server_args[0] << " is not listening on 127.0.0.1:" << port << std::endl;
+            return 1;
+        }
+
+        asio::io_service ios;
+        auto done = bench(ios, server, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), port), block_size,
+                          connections, active, sources, timeout);
+        run_io_thread(ios, 0);
+        done.get();
+
+        server.interrupt();
+        server.wait();
+
+        std::cerr << "server output in " << server_output << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+//
+// channel_bench.cpp
+// ~~~~~~~~~~~~~~~~~
+//
+// channel.h throughput and latency for several capacities and producer/consumer counts.
+// Producers and consumers are coroutines on a threadpool.h pool.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <numeric>
+#include <vector>
+
+#include <channel.h>
+#include <threadpool.h>
+
+// a message carries its send time
+using message = std::chrono::steady_clock::time_point;
+
+std::future<void>
+producer(threadpool::pool&, channel<message>& ch, size_t count, std::atomic<size_t>& active, std::latch& done)
+{
+    for (size_t i = 0; i < count; ++i)
+        co_await ch.send(std::chrono::steady_clock::now());
+
+    // the last producer closes the channel
+    if (active.fetch_sub(1) == 1)
+        ch.close();
+
+    done.count_down();
+}
+
+std::future<void>
+consumer(threadpool::pool&, channel<message>& ch, size_t batch, std::vector<long long>& latencies, std::latch& done)
+{
+    auto latency = [](message sent)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sent).count();
+    };
+
+    if (batch > 1)
+    {
+        std::vector<message> values;
+        values.reserve(batch);
+
+        while (co_await ch.receive_batch(values, batch))
+        {
+            for (auto v : values)
+                latencies.push_back(latency(v));
+            values.clear();
+        }
+    }
+    else
+    {
+        while (auto v = co_await ch.receive())
+            latencies.push_back(latency(*v));
+    }
+
+    done.count_down();
+}
+
+void measure(unsigned threads, size_t messages, size_t capacity, size_t producers, size_t consumers, size_t batch)
+{
+    threadpool::pool pool(threads);
+    channel<message> ch(capacity);
+
+    std::vector<std::vector<long long>> latencies(consumers);
+    std::atomic<size_t> active = producers;
+    std::latch done(producers + consumers);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto& l : latencies)
+        consumer(pool, ch, batch, l, done);
+
+    for (size_t i = 0; i < producers; ++i)
+        producer(pool, ch, messages / producers, active, done);
+
+    done.wait();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<long long> all;
+    for (auto& l : latencies)
+        all.insert(all.end(), l.begin(), l.end());
+
+    auto received = all.size();
+    auto average = received ? std::accumulate(all.begin(), all.end(), 0.0) / received : 0.0;
+    auto p99 = all.begin() + received * 99 / 100;
+    if (received)
+        std::nth_element(all.begin(), p99, all.end());
+
+    std::cout << "capacity " << std::setw(5) << capacity
+              << ", " << producers << "P/" << consumers << "C"
+              << ", batch " << std::setw(3) << batch << ": "
+              << std::fixed << std::setprecision(2)
+              << received / elapsed.count() / 1e6 << " M msgs/s, latency "
+              << average / 1e3 << " us average, "
+              << (received ? *p99 / 1e3 : 0.0) << " us p99"
+              << (received == messages / producers * producers ? "" : " LOST MESSAGES")
+              << std::defaultfloat << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: channel_bench <threads> <messages>" << std::endl;
+        return 1;
+    }
+
+    unsigned threads = atoi(argv[1]);
+    size_t messages = atoi(argv[2]);
+
+    for (size_t capacity : {1, 64, 1024})
+        for (auto [producers, consumers] : {std::pair{1, 1}, std::pair{4, 4}, std::pair{8, 1}})
+            for (size_t batch : {1, 64})
+                measure(threads, messages, capacity, producers, consumers, batch);
+
+    return 0;
+}
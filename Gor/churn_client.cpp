@@ -0,0 +1,211 @@
+//
+// churn_client.cpp
+// ~~~~~~~~~~~~~~~~
+//
+// Connection churn variant of client.cpp: every session connects, performs <round trips> round trips, closes
+// and starts over, so the accept, the session coroutine and its teardown (EOF exception included) of the server
+// are paid once per connection instead of once per run.
+//
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include <asio.hpp>
+#include <asio/system_timer.hpp>
+
+#include <alloc_stats.h>
+#include <asio_future_await.h>
+#include <await_adapters.h>
+#include <busy_poll.h>
+#include <future_adapter.h>
+#include <latency_histogram.h>
+
+struct churn_stats
+{
+    size_t connections = 0;
+    latency_histogram connects;    // connect() until connected
+    latency_histogram round_trips;
+    latency_histogram teardowns;   // shutdown of the sending side until the server closed the connection
+
+    void merge(const churn_stats& other)
+    {
+        connections += other.connections;
+        connects.merge(other.connects);
+        round_trips.merge(other.round_trips);
+        teardowns.merge(other.teardowns);
+    }
+
+    void print(std::chrono::duration<double> elapsed) const
+    {
+        std::cout << connections << " connections, " << static_cast<double>(connections) / elapsed.count()
+                  << " connections/s" << std::endl;
+        std::cout << "connect latency: " << connects << std::endl;
+        std::cout << "round trip latency: " << round_trips << std::endl;
+        std::cout << "teardown latency: " << teardowns << std::endl;
+        report_allocations(std::cout, connections, "connection");
+    }
+};
+
+std::future<churn_stats>
+session(asio::io_service& ios,
+        asio::ip::tcp::resolver::iterator& endpoint_iterator,
+        const size_t block_size,
+        const size_t round_trips,
+        std::stop_token stop)
+{
+    auto read_data = std::make_unique<char[]>(block_size);
+    auto write_data = std::make_unique<char[]>(block_size);
+    churn_stats stats;
+
+    for (size_t i = 0; i < block_size; ++i)
+        write_data[i] = static_cast<char>(i % 128);
+
+    try
+    {
+        while (!stop.stop_requested())
+        {
+            asio::ip::tcp::socket socket(ios);
+
+            // Connect to the server
+            auto start = std::chrono::steady_clock::now();
+            co_await async_connect(socket, endpoint_iterator);
+            stats.connects.record(std::chrono::steady_clock::now() - start);
+            socket.set_option(asio::ip::tcp::no_delay(true));
+
+            for (size_t i = 0; i < round_trips; ++i)
+            {
+                start = std::chrono::steady_clock::now();
+                co_await async_write(socket, asio::buffer(write_data.get(), block_size));
+                co_await async_read_some(socket, asio::buffer(read_data.get(), block_size));
+                stats.round_trips.record(std::chrono::steady_clock::now() - start);
+            }
+
+            // Close our side and wait for the server to close its own
+            start = std::chrono::steady_clock::now();
+            socket.shutdown(asio::ip::tcp::socket::shutdown_send);
+            try
+            {
+                for (;;)
+                    co_await async_read_some(socket, asio::buffer(read_data.get(), block_size));
+            }
+            catch (std::system_error& e)
+            {
+                if (e.code() != asio::error::eof)
+                    throw;
+            }
+            stats.teardowns.record(std::chrono::steady_clock::now() - start);
+
+            socket.close();
+            ++stats.connections;
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (e.code() != asio::error::operation_aborted)
+            std::cerr << "Exception: " << e.what() << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    co_return stats;
+}
+
+std::future<void>
+client(asio::io_service& ios,
+       asio::ip::tcp::resolver::iterator& endpoint_iterator,
+       const size_t block_size,
+       const size_t round_trips,
+       const size_t session_count,
+       const int timeout)
+{
+    std::list<std::future<churn_stats>> sessions;
+    std::stop_source stop;
+    churn_stats stats;
+
+    // Launch the sessions
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < session_count; ++i)
+        sessions.push_back(session(ios, endpoint_iterator, block_size, round_trips, stop.get_token()));
+
+    // Wait the specified timeout
+    asio::system_timer stop_timer(ios);
+    co_await async_wait(stop_timer, std::chrono::seconds(timeout));
+
+    // Stop the sessions: the connections in progress are abandoned, not counted. The cancellations are posted to the
+    // io_service, and a session resumes once its cancellation ran: its socket, destroyed at every iteration, is not
+    // cancelled after it is gone
+    stop.request_stop();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    while (!sessions.empty())
+    {
+        stats.merge(co_await asio_future_awaiter(ios, std::move(sessions.front())));
+        sessions.pop_front();
+    }
+
+    // Show stats
+    stats.print(elapsed);
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 8)
+        {
+            std::cerr << "Usage: churn_client <host> <port> <threads> <blocksize> "
+                      << "<round trips> <sessions> <time>" << std::endl;
+            return 1;
+        }
+
+        using namespace std; // For atoi.
+        const char* host = argv[1];
+        const char* port = argv[2];
+        int thread_count = atoi(argv[3]);
+        size_t block_size = atoi(argv[4]);
+        size_t round_trips = atoi(argv[5]);
+        size_t session_count = atoi(argv[6]);
+        int timeout = atoi(argv[7]);
+
+        asio::io_service ios;
+
+        asio::ip::tcp::resolver r(ios);
+        asio::ip::tcp::resolver::iterator iter =
+            r.resolve(asio::ip::tcp::resolver::query(host, port));
+
+        client(ios, iter, block_size, round_trips, session_count, timeout);
+
+        // io threads (see busy_poll.h for the low latency knobs)
+        auto start = std::chrono::steady_clock::now();
+        std::list<std::thread*> threads;
+        for (int i = 1; i < thread_count; ++i)
+        {
+            std::thread* new_thread = new std::thread([&ios, i] { run_io_thread(ios, i); });
+            threads.push_back(new_thread);
+        }
+
+        run_io_thread(ios, 0);
+
+        while (!threads.empty())
+        {
+            threads.front()->join();
+            delete threads.front();
+            threads.pop_front();
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "cpu " << cpu_seconds() << " s in " << elapsed.count() << " s" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -26,6 +26,7 @@ namespace asio::placeholders
 }
 
 #include <handler_allocator.h>
+#include <perf_counters.h>
 
 class stats
 {
@@ -33,15 +34,24 @@ public:
   stats()
     : mutex_(),
       total_bytes_written_(0),
-      total_bytes_read_(0)
+      total_bytes_read_(0),
+      round_trips_(0)
   {
   }
 
-  void add(size_t bytes_written, size_t bytes_read)
+  void add(size_t bytes_written, size_t bytes_read, size_t round_trips)
   {
     asio::detail::mutex::scoped_lock lock(mutex_);
     total_bytes_written_ += bytes_written;
     total_bytes_read_ += bytes_read;
+    round_trips_ += round_trips;
+  }
+
+  // completed reads, each answering a write: the round trips of client.cpp
+  size_t round_trips()
+  {
+    asio::detail::mutex::scoped_lock lock(mutex_);
+    return round_trips_;
   }
 
   void print()
@@ -55,6 +65,7 @@ private:
   asio::detail::mutex mutex_;
   size_t total_bytes_written_;
   size_t total_bytes_read_;
+  size_t round_trips_;
 };
 
 class session
@@ -70,6 +81,7 @@ public:
       unwritten_count_(0),
       bytes_written_(0),
       bytes_read_(0),
+      round_trips_(0),
       stats_(s)
   {
     for (size_t i = 0; i < block_size_; ++i)
@@ -78,7 +90,7 @@ public:
 
   ~session()
   {
-    stats_.add(bytes_written_, bytes_read_);
+    stats_.add(bytes_written_, bytes_read_, round_trips_);
 
     delete[] read_data_;
     delete[] write_data_;
@@ -128,6 +140,7 @@ private:
     if (!err)
     {
       bytes_read_ += length;
+      ++round_trips_;
 
       read_data_length_ = length;
       ++unwritten_count_;
@@ -191,6 +204,7 @@ private:
   int unwritten_count_;
   size_t bytes_written_;
   size_t bytes_read_;
+  size_t round_trips_;
   stats& stats_;
   handler_allocator read_allocator_;
   handler_allocator write_allocator_;
@@ -207,6 +221,9 @@ public:
       sessions_(),
       stats_()
   {
+    // GOR_PERF_COUNTERS: before the io threads are created, they inherit the counters
+    counters_.start();
+
     stop_timer_.expires_from_now(std::chrono::seconds(timeout));
     stop_timer_.async_wait(std::bind(&client::handle_timeout, this));
 
@@ -227,10 +244,12 @@ public:
     }
 
     stats_.print();
+    counters_.print(std::cout, stats_.round_trips());
   }
 
   void handle_timeout()
   {
+    counters_.stop();
     std::for_each(sessions_.begin(), sessions_.end(),
           std::mem_fn(&session::stop));
   }
@@ -240,6 +259,7 @@ private:
   asio::system_timer stop_timer_;
   std::list<session*> sessions_;
   stats stats_;
+  perf_counters counters_;
 };
 
 int main(int argc, char* argv[])
@@ -9,12 +9,12 @@
 //
 
 #include <algorithm>
-#include <atomic>
 #include <chrono>
 #include <functional>
 #include <iostream>
 #include <list>
 #include <memory>
+#include <stop_token>
 #include <string>
 #include <thread>
 #include <utility>
@@ -22,9 +22,22 @@
 #include <asio.hpp>
 #include <asio/system_timer.hpp>
 
+#include <alloc_stats.h>
 #include <asio_future_await.h>
+#include <await_stats.h>
 #include <await_adapters.h>
+#include <busy_poll.h>
 #include <future_adapter.h>
+#include <latency_histogram.h>
+#include <perf_counters.h>
+#include <probes.h>
+
+struct session_stats
+{
+  size_t bytes_written = 0;
+  size_t bytes_read = 0;
+  latency_histogram round_trips;
+};
 
 class stats
 {
@@ -35,34 +48,44 @@ public:
   {
   }
 
-  void add(size_t bytes_written, size_t bytes_read)
+  void add(const session_stats& session)
+  {
+    total_bytes_written_ += session.bytes_written;
+    total_bytes_read_ += session.bytes_read;
+    round_trips_.merge(session.round_trips);
+  }
+
+  std::uint64_t round_trips() const
   {
-    total_bytes_written_ += bytes_written;
-    total_bytes_read_ += bytes_read;
+    return round_trips_.count();
   }
 
   void print()
   {
     std::cout << total_bytes_written_ << " total bytes written" << std::endl;
     std::cout << total_bytes_read_ << " total bytes read" << std::endl;
+    std::cout << "round trip latency: " << round_trips_ << std::endl;
+    report_allocations(std::cout, round_trips_.count());
+    if (await_stats_enabled)
+      await_stats::print(std::cout);
   }
 
 private:
   size_t total_bytes_written_;
   size_t total_bytes_read_;
+  latency_histogram round_trips_;
 };
 
-std::future<std::pair<size_t, size_t>>
+std::future<session_stats>
 session(asio::io_service& ios,
         asio::ip::tcp::resolver::iterator& endpoint_iterator,
         const size_t block_size,
-        std::atomic_bool& stop)
+        std::stop_token stop)
 {
     asio::ip::tcp::socket socket(ios);
     auto read_data = std::make_unique<char[]>(block_size);
     auto write_data = std::make_unique<char[]>(block_size);
-    size_t bytes_written = 0;
-    size_t bytes_read = 0;
+    session_stats stats;
 
     try
     {
@@ -72,27 +95,39 @@ session(asio::io_service& ios,
 
         // Connect to the server
         co_await async_connect(socket, endpoint_iterator);
+        tune_socket(socket);
+        GOR_PROBE1(session_start, socket.native_handle());
 
-        // Once connected loop endlessly
-        while (!stop)
+        // Once connected loop until stopped: the token is propagated into the awaiters (cancellation.h)
+        // and a stop request aborts the pending operation instead of waiting for the round trip
+        while (!stop.stop_requested())
         {
+            auto start = std::chrono::steady_clock::now();
             // Send data to the server
-            bytes_written += co_await async_write(socket, asio::buffer(write_data.get(), block_size));
+            stats.bytes_written += co_await async_write(socket, asio::buffer(write_data.get(), block_size));
             // Receive data from the server
-            bytes_read += co_await async_read_some(socket, asio::buffer(read_data.get(), block_size));
+            stats.bytes_read += co_await async_read_some(socket, asio::buffer(read_data.get(), block_size));
+            stats.round_trips.record(std::chrono::steady_clock::now() - start);
             // Swap the buffers
             std::swap(read_data, write_data);
         }
     }
+    catch (std::system_error& e)
+    {
+        if (e.code() != asio::error::operation_aborted)
+            std::cerr << "Exception: " << e.what() << std::endl;
+    }
     catch (std::exception& e)
     {
         std::cerr << "Exception: " << e.what() << std::endl;
     }
 
     // Close the socket
+    if (socket.is_open())
+        GOR_PROBE1(session_end, socket.native_handle());
     socket.close();
 
-    co_return std::pair<size_t, size_t>{bytes_written, bytes_read};
+    co_return stats;
 }
 
 std::future<void>
@@ -102,33 +137,39 @@ client(asio::io_service& ios,
        const size_t session_count,
        const int timeout)
 {
-    using session_future = std::future<std::pair<size_t, size_t>>;
+    using session_future = std::future<session_stats>;
 
     std::list<session_future> sessions;
-    std::atomic_bool stop(false);
+    std::stop_source stop;
     stats stats;
 
+    // GOR_PERF_COUNTERS: before the io threads are created, they inherit the counters
+    perf_counters counters;
+    counters.start();
+
     // Launch the sessions
     for (size_t i = 0; i < session_count; ++i)
     {
-        sessions.push_back(session(ios, endpoint_iterator, block_size, stop));
+        sessions.push_back(session(ios, endpoint_iterator, block_size, stop.get_token()));
     }
 
     // Wait the specified timeout
     asio::system_timer stop_timer(ios);
     co_await async_wait(stop_timer, std::chrono::seconds(timeout));
+    counters.stop();
 
-    // Stop the sessions
-    stop = true;
+    // Stop the sessions: the cancellations are posted to the io_service, to whichever io thread runs the sockets
+    stop.request_stop();
     while (!sessions.empty())
     {
-        auto times = co_await asio_future_awaiter(ios, std::move(sessions.front()));
-        stats.add(times.first, times.second);
+        auto session = co_await asio_future_awaiter(ios, std::move(sessions.front()));
+        stats.add(session);
         sessions.pop_front();
     }
 
     // Show stats
     stats.print();
+    counters.print(std::cout, stats.round_trips());
 }
 
 int main(int argc, char* argv[])
@@ -158,16 +199,17 @@ int main(int argc, char* argv[])
 
     client(ios, iter, block_size, session_count, timeout);
 
+    // io threads (see busy_poll.h for the low latency knobs)
+    auto start = std::chrono::steady_clock::now();
     std::list<std::thread*> threads;
-    while (--thread_count > 0)
+    for (int i = 1; i < thread_count; ++i)
     {
-      std::size_t (asio::io_service::* handler)() = &asio::io_service::run;
       std::thread* new_thread = new std::thread(
-            std::bind(handler, &ios));
+            [&ios, i] { run_io_thread(ios, i); });
       threads.push_back(new_thread);
     }
 
-    ios.run();
+    run_io_thread(ios, 0);
 
     while (!threads.empty())
     {
@@ -175,6 +217,9 @@ int main(int argc, char* argv[])
       delete threads.front();
       threads.pop_front();
     }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "cpu " << cpu_seconds() << " s in " << elapsed.count() << " s" << std::endl;
   }
   catch (std::exception& e)
   {
@@ -0,0 +1,92 @@
+//
+// dispatch_bench.cpp
+// ~~~~~~~~~~~~~~~~~~
+//
+// over1.cpp/over2.cpp repost loops measured in ops/s: co_await post(io) (always a queue round trip),
+// co_await dispatch(io) (keeps running when already on an io thread) and the future based post of over1.cpp.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <asio.hpp>
+
+#include <asio_future_await.h>
+#include <await_adapters.h>
+#include <future_adapter.h>
+
+using clock_type = std::chrono::steady_clock;
+
+// reposts in batches (between clock reads) until the time is over
+template <typename Repost>
+std::future<void>
+repost(asio::io_service& io, const char* name, std::chrono::milliseconds duration, size_t batch, Repost hop)
+{
+    // start on the io thread
+    co_await post(io);
+
+    size_t ops = 0;
+    auto start = clock_type::now();
+    auto deadline = start + duration;
+
+    do
+    {
+        for (size_t i = 0; i < batch; ++i)
+            co_await hop();
+
+        ops += batch;
+    }
+    while (clock_type::now() < deadline);
+
+    std::chrono::duration<double> elapsed = clock_type::now() - start;
+    std::cout << std::setw(32) << std::left << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << ops / elapsed.count() << " ops/s" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 2)
+        {
+            std::cerr << "Usage: dispatch_bench <milliseconds>" << std::endl;
+            return 1;
+        }
+
+        std::chrono::milliseconds duration(atoi(argv[1]));
+
+        {
+            asio::io_service io;
+            repost(io, "post", duration, 64, [&io] { return post(io); });
+            run(io);
+        }
+
+        {
+            asio::io_service io;
+            repost(io, "dispatch", duration, 64, [&io] { return dispatch(io); });
+            run(io);
+        }
+
+        // io thread not started through run(): dispatch falls back to post
+        {
+            asio::io_service io;
+            repost(io, "dispatch (unmarked io thread)", duration, 64, [&io] { return dispatch(io); });
+            io.run();
+        }
+
+        // over1.cpp: the awaiter polls the future every 100 ms
+        {
+            asio::io_service io;
+            repost(io, "post (use_future)", duration, 1, [&io] { return post(io, my_use_future); });
+            run(io);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
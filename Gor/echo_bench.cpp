@@ -0,0 +1,264 @@
+//
+// echo_bench.cpp
+// ~~~~~~~~~~~~~~
+//
+// Benchmark driver for the echo servers: classic_server (callbacks), easy/hard1/hard2 (futures), server
+// (coroutines) and epoll_server (coroutines on the epoll reactor). For every point of the
+// threads x blocksize x sessions sweep it starts the server as a child process, runs the coroutine client against
+// it over loopback and collects the throughput, the round trip latency percentiles and the CPU time of both
+// processes, so the hand copied tables of the README can be reproduced in one run.
+// The executables are looked up next to echo_bench; the missing ones are skipped. The single threaded servers
+// only take part in the threads = 1 points. POSIX only.
+//
+// Output is CSV or JSON on stdout, one record per run, progress goes to stderr.
+//
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <child_process.h>
+
+struct variant
+{
+    const char* name;
+    const char* server;
+    bool threaded; // takes <threads> before <blocksize>
+};
+
+const variant variants[] = {
+    {"classic", "classic_server", true},
+    {"easy", "easy", false},
+    {"hard1", "hard1", false},
+    {"hard2", "hard2", false},
+    {"coroutine", "server", true},
+    {"epoll", "epoll_server", false},
+};
+
+struct result
+{
+    std::string variant;
+    int threads = 0;
+    size_t block_size = 0;
+    size_t sessions = 0;
+
+    double seconds = 0;
+    double bytes_read = 0;
+    double round_trips = 0;
+    double p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0; // us
+    double server_cpu = 0, client_cpu = 0;               // s
+    std::optional<double> allocations;                   // reported by instrumented builds only
+
+    double mb_per_second() const { return seconds > 0 ? bytes_read / seconds / 1e6 : 0; }
+    double ops_per_second() const { return seconds > 0 ? round_trips / seconds : 0; }
+    double cpu_us_per_op() const { return round_trips > 0 ? (server_cpu + client_cpu) * 1e6 / round_trips : 0; }
+};
+
+std::vector<std::string> split(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+std::string read_file(const std::string& path)
+{
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// number following the label in the text, if any
+std::optional<double> number_after(const std::string& text, const std::string& label)
+{
+    auto pos = text.find(label);
+    if (pos == std::string::npos)
+        return std::nullopt;
+
+    return std::strtod(text.c_str() + pos + label.size(), nullptr);
+}
+
+// number in front of the label (client totals: "<n> total bytes read")
+std::optional<double> number_before(const std::string& text, const std::string& label)
+{
+    auto pos = text.find(label);
+    if (pos == std::string::npos)
+        return std::nullopt;
+
+    auto begin = text.rfind('\n', pos);
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    return std::strtod(text.c_str() + begin, nullptr);
+}
+
+std::optional<result> measure(const std::string& directory, const variant& v, const std::string& address,
+                              unsigned short port, int threads, size_t block_size, size_t sessions, int seconds)
+{
+    std::string server_path = directory + v.server;
+    std::string client_path = directory + "client";
+    if (::access(server_path.c_str(), X_OK) != 0)
+        return std::nullopt;
+
+    std::string server_output = "/tmp/echo_bench_server." + std::to_string(::getpid());
+    std::string client_output = "/tmp/echo_bench_client." + std::to_string(::getpid());
+
+    std::vector<std::string> server_args{server_path, address, std::to_string(port)};
+    if (v.threaded)
+        server_args.push_back(std::to_string(threads));
+    server_args.push_back(std::to_string(block_size));
+
+    child server(server_args, server_output);
+    if (!wait_listening(server, address, port))
+    {
+        std::cerr << v.server << " is not listening on " << address << ':' << port << std::endl;
+        return std::nullopt;
+    }
+
+    child client({client_path, address, std::to_string(port), std::to_string(threads), std::to_string(block_size),
+                  std::to_string(sessions), std::to_string(seconds)},
+                 client_output);
+
+    result r;
+    r.variant = v.name;
+    r.threads = threads;
+    r.block_size = block_size;
+    r.sessions = sessions;
+    r.client_cpu = client.wait();
+
+    server.interrupt();
+    r.server_cpu = server.wait();
+
+    std::string client_text = read_file(client_output);
+    std::string server_text = read_file(server_output);
+    std::remove(client_output.c_str());
+    std::remove(server_output.c_str());
+
+    r.seconds = number_after(client_text, " s in ").value_or(seconds);
+    r.bytes_read = number_before(client_text, " total bytes read").value_or(0);
+    r.round_trips = r.bytes_read / static_cast<double>(block_size);
+    r.p50 = number_after(client_text, " p50 ").value_or(0);
+    r.p90 = number_after(client_text, " p90 ").value_or(0);
+    r.p99 = number_after(client_text, " p99 ").value_or(0);
+    r.p999 = number_after(client_text, " p99.9 ").value_or(0);
+    r.max = number_after(client_text, " max ").value_or(0);
+
+    auto client_allocations = number_after(client_text, "allocations ");
+    auto server_allocations = number_after(server_text, "allocations ");
+    // only the instrumented servers report theirs: the client alone would not compare with them
+    if (client_allocations && server_allocations)
+        r.allocations = *client_allocations + *server_allocations;
+
+    return r;
+}
+
+void print_csv_header()
+{
+    std::cout << "variant,threads,blocksize,sessions,seconds,mb_per_s,ops_per_s,p50_us,p90_us,p99_us,p999_us,max_us,"
+                 "server_cpu_s,client_cpu_s,cpu_us_per_op,allocs_per_op"
+              << std::endl;
+}
+
+void print_csv(const result& r)
+{
+    std::cout << r.variant << ',' << r.threads << ',' << r.block_size << ',' << r.sessions << ',' << r.seconds << ','
+              << r.mb_per_second() << ',' << r.ops_per_second() << ',' << r.p50 << ',' << r.p90 << ',' << r.p99
+              << ',' << r.p999 << ',' << r.max << ',' << r.server_cpu << ',' << r.client_cpu << ','
+              << r.cpu_us_per_op() << ',';
+    if (r.allocations && r.round_trips > 0)
+        std::cout << *r.allocations / r.round_trips;
+    std::cout << std::endl;
+}
+
+void print_json(const result& r, bool first)
+{
+    std::cout << (first ? "[\n" : ",\n") << "  {\"variant\": \"" << r.variant << "\", \"threads\": " << r.threads
+              << ", \"blocksize\": " << r.block_size << ", \"sessions\": " << r.sessions
+              << ", \"seconds\": " << r.seconds << ", \"mb_per_s\": " << r.mb_per_second()
+              << ", \"ops_per_s\": " << r.ops_per_second() << ", \"p50_us\": " << r.p50 << ", \"p90_us\": " << r.p90
+              << ", \"p99_us\": " << r.p99 << ", \"p999_us\": " << r.p999 << ", \"max_us\": " << r.max
+              << ", \"server_cpu_s\": " << r.server_cpu << ", \"client_cpu_s\": " << r.client_cpu
+              << ", \"cpu_us_per_op\": " << r.cpu_us_per_op() << ", \"allocs_per_op\": ";
+    if (r.allocations && r.round_trips > 0)
+        std::cout << *r.allocations / r.round_trips;
+    else
+        std::cout << "null";
+    std::cout << "}" << std::flush;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 8)
+        {
+            std::cerr << "Usage: echo_bench <address> <port> <threads,...> <blocksize,...> <sessions,...> <time> "
+                      << "<csv|json>" << std::endl;
+            return 1;
+        }
+
+        std::string address = argv[1];
+        auto port = static_cast<unsigned short>(atoi(argv[2]));
+        auto thread_list = split(argv[3]);
+        auto block_size_list = split(argv[4]);
+        auto session_list = split(argv[5]);
+        int seconds = atoi(argv[6]);
+        bool json = std::string(argv[7]) == "json";
+
+        // the servers and the client are installed next to echo_bench
+        std::string directory = argv[0];
+        auto slash = directory.rfind('/');
+        directory = slash == std::string::npos ? "./" : directory.substr(0, slash + 1);
+
+        if (!json)
+            print_csv_header();
+
+        bool first = true;
+        for (auto& threads : thread_list)
+            for (auto& block_size : block_size_list)
+                for (auto& sessions : session_list)
+                    for (auto& v : variants)
+                    {
+                        int thread_count = atoi(threads.c_str());
+                        if (!v.threaded && thread_count != 1)
+                            continue;
+
+                        std::cerr << v.name << " threads " << threads << " blocksize " << block_size << " sessions "
+                                  << sessions << std::endl;
+
+                        // a fresh port per run: no waiting for the sockets of the previous one in TIME_WAIT
+                        auto r = measure(directory, v, address, port++, thread_count,
+                                         static_cast<size_t>(atoi(block_size.c_str())),
+                                         static_cast<size_t>(atoi(sessions.c_str())), seconds);
+                        if (!r)
+                            continue;
+
+                        if (json)
+                            print_json(*r, first);
+                        else
+                            print_csv(*r);
+                        first = false;
+                    }
+
+        if (json)
+            std::cout << (first ? "[]" : "\n]") << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
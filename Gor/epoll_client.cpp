@@ -0,0 +1,107 @@
+//
+// epoll_client.cpp
+// ~~~~~~~~~~~~~~~~
+//
+// client.cpp on the experimental epoll reactor (epoll_reactor.h) instead of asio (Linux only).
+// The reactor has no timers: the sessions check the deadline on every round trip.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include <epoll_reactor.h>
+#include <future_adapter.h>
+
+struct stats
+{
+    size_t total_bytes_written = 0;
+    size_t total_bytes_read = 0;
+
+    void print() const
+    {
+        std::cout << total_bytes_written << " total bytes written" << std::endl;
+        std::cout << total_bytes_read << " total bytes read" << std::endl;
+    }
+};
+
+std::future<void>
+session(epoll::reactor& reactor,
+        const sockaddr_in& endpoint,
+        const size_t block_size,
+        std::chrono::steady_clock::time_point deadline,
+        stats& stats)
+{
+    epoll::socket socket(reactor);
+    auto read_data = std::make_unique<char[]>(block_size);
+    auto write_data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        // Initialize the original client data
+        for (size_t i = 0; i < block_size; ++i)
+            write_data[i] = static_cast<char>(i % 128);
+
+        // Connect to the server
+        co_await async_connect(socket, endpoint);
+        socket.set_no_delay(true);
+
+        // Once connected loop until the time is over
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            // Send data to the server
+            stats.total_bytes_written += co_await async_write(socket, epoll::buffer(write_data.get(), block_size));
+            // Receive data from the server
+            auto n = co_await async_read_some(socket, epoll::buffer(read_data.get(), block_size));
+            if (n == 0)
+                break;
+            stats.total_bytes_read += n;
+            // Swap the buffers
+            std::swap(read_data, write_data);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 6)
+        {
+            std::cerr << "Usage: epoll_client <address> <port> <blocksize> <sessions> <time>" << std::endl;
+            return 1;
+        }
+
+        using namespace std; // For atoi.
+        auto port = static_cast<unsigned short>(atoi(argv[2]));
+        size_t block_size = atoi(argv[3]);
+        size_t session_count = atoi(argv[4]);
+        std::chrono::seconds timeout(atoi(argv[5]));
+
+        epoll::reactor reactor;
+        auto endpoint = epoll::endpoint(argv[1], port);
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        stats stats;
+
+        // Launch the sessions
+        for (size_t i = 0; i < session_count; ++i)
+            session(reactor, endpoint, block_size, deadline, stats);
+
+        // returns once all the sessions are over
+        reactor.run();
+
+        stats.print();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
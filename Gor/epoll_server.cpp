@@ -0,0 +1,107 @@
+//
+// epoll_server.cpp
+// ~~~~~~~~~~~~~~~~
+//
+// server.cpp on the experimental epoll reactor (epoll_reactor.h) instead of asio (Linux only).
+//
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include <alloc_stats.h>
+#include <epoll_reactor.h>
+#include <future_adapter.h>
+
+std::future<void>
+session(epoll::socket socket,
+        const size_t block_size)
+{
+    auto read_data = std::make_unique<char[]>(block_size);
+    auto write_data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        // Initialization
+        socket.set_no_delay(true);
+
+        // loop until the client leaves
+        for (;;)
+        {
+            // Receive data from the client
+            if (co_await async_read_some(socket, epoll::buffer(read_data.get(), block_size)) == 0)
+                break;
+            // Swap the buffers
+            std::swap(read_data, write_data);
+            // Send data back to the client
+            co_await async_write(socket, epoll::buffer(write_data.get(), block_size));
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (e.code() != std::errc::connection_reset && e.code() != std::errc::broken_pipe)
+            std::cerr << "System error: " << e.what() << std::endl;
+    }
+}
+
+std::future<void>
+server(epoll::reactor& reactor,
+       sockaddr_in endpoint,
+       const size_t block_size)
+{
+    try
+    {
+        epoll::acceptor acceptor(reactor, endpoint);
+
+        // loop accepting connections
+        for (;;)
+        {
+            epoll::socket socket(reactor);
+            co_await async_accept(acceptor, socket);
+            session(std::move(socket), block_size);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+}
+
+epoll::reactor* running_reactor = nullptr;
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 4)
+        {
+            std::cerr << "Usage: epoll_server <address> <port> <blocksize>" << std::endl;
+            return 1;
+        }
+
+        using namespace std; // For atoi.
+        auto port = static_cast<unsigned short>(atoi(argv[2]));
+        size_t block_size = atoi(argv[3]);
+
+        epoll::reactor reactor;
+
+        server(reactor, epoll::endpoint(argv[1], port), block_size);
+
+        // Handle user signals for loop interruption (stop() is async signal safe)
+        running_reactor = &reactor;
+        std::signal(SIGINT, [](int) { running_reactor->stop(); });
+        std::signal(SIGTERM, [](int) { running_reactor->stop(); });
+
+        // loop until interrupted
+        reactor.run();
+
+        report_allocations(std::cout);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
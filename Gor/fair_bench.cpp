@@ -0,0 +1,218 @@
+//
+// fair_bench.cpp
+// ~~~~~~~~~~~~~~
+//
+// Fairness of an io thread between a few hot clients, which always have data ready, and many cold ones,
+// which send a small block every millisecond. The server sessions read and process the blocks; their sockets are
+// in non-blocking mode, so the reads complete synchronously while data is there and the coop budget (coop.h)
+// decides how long a hot session keeps the thread.
+// Reports the spread of the per-session throughput for several budgets.
+// The clients are connected through local socket pairs (POSIX only).
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <asio.hpp>
+
+#include <await_adapters.h>
+#include <coop.h>
+#include <future_adapter.h>
+
+using local_socket = asio::local::stream_protocol::socket;
+using clock_type = std::chrono::steady_clock;
+
+const size_t block_size = 4096;
+const size_t cold_block_size = 256;
+
+// keeps the processing result alive
+std::atomic<std::uint64_t> digest{0};
+
+std::uint64_t process(const char* data, size_t n)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < n; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+std::future<void>
+session(local_socket socket, bool synchronous, clock_type::time_point deadline, std::stop_token, size_t& bytes)
+{
+    auto data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        socket.non_blocking(synchronous);
+
+        while (clock_type::now() < deadline)
+        {
+            auto n = co_await async_read_some(socket, asio::buffer(data.get(), block_size));
+            digest.fetch_xor(process(data.get(), n), std::memory_order_relaxed);
+            bytes += n;
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (e.code() != asio::error::operation_aborted)
+            std::cerr << "System error: " << e.what() << std::endl;
+    }
+}
+
+// cancels the sessions still waiting for data
+std::future<void>
+stop_at(asio::io_service& ios, clock_type::time_point deadline, std::stop_source& stop)
+{
+    asio::steady_timer timer(ios);
+    co_await async_wait(timer, deadline - clock_type::now());
+    stop.request_stop();
+}
+
+// writes as fast as the session reads until it goes away
+void hot_client(local_socket& socket)
+{
+    std::vector<char> data(16 * block_size, 'h');
+    asio::error_code ec;
+    while (!ec)
+        asio::write(socket, asio::buffer(data), ec);
+}
+
+// a small block every millisecond, dropped if the session lags behind
+void cold_clients(std::vector<local_socket>& sockets, const std::atomic_bool& stop)
+{
+    std::vector<char> data(cold_block_size, 'c');
+    for (auto& socket : sockets)
+        socket.non_blocking(true);
+
+    auto next = clock_type::now();
+    while (!stop)
+    {
+        for (auto& socket : sockets)
+        {
+            asio::error_code ec;
+            socket.write_some(asio::buffer(data), ec);
+        }
+
+        next += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+// throughput spread of a class of sessions
+void report(const char* name, const std::vector<size_t>& bytes, double seconds, double unit)
+{
+    if (bytes.empty())
+        return;
+
+    auto [min, max] = std::minmax_element(bytes.begin(), bytes.end());
+    double sum = 0, squares = 0;
+    for (auto b : bytes)
+    {
+        sum += static_cast<double>(b);
+        squares += static_cast<double>(b) * static_cast<double>(b);
+    }
+
+    // Jain's fairness index: 1 when all sessions get the same throughput, 1/n when one gets it all
+    double jain = squares > 0 ? sum * sum / (static_cast<double>(bytes.size()) * squares) : 1;
+
+    std::cout << ", " << name << " " << std::setw(7) << *min / seconds / unit
+              << " - " << std::setw(7) << *max / seconds / unit
+              << " (jain " << std::setprecision(2) << jain << std::setprecision(1) << ")";
+}
+
+void measure(const std::string& label, bool synchronous, size_t hot, size_t cold, std::chrono::milliseconds duration)
+{
+    asio::io_service ios;
+    asio::io_service client_ios; // only owns the client sockets
+
+    std::vector<local_socket> hot_sockets, cold_sockets;
+    std::vector<size_t> hot_bytes(hot), cold_bytes(cold);
+    std::stop_source stop;
+
+    auto deadline = clock_type::now() + duration;
+
+    for (size_t i = 0; i < hot + cold; ++i)
+    {
+        local_socket socket(ios);
+        auto& clients = i < hot ? hot_sockets : cold_sockets;
+        clients.emplace_back(client_ios);
+        asio::local::connect_pair(socket, clients.back());
+
+        auto& bytes = i < hot ? hot_bytes[i] : cold_bytes[i - hot];
+        session(std::move(socket), synchronous, deadline, stop.get_token(), bytes);
+    }
+
+    stop_at(ios, deadline, stop);
+
+    std::atomic_bool cold_stop(false);
+    std::vector<std::thread> threads;
+    for (auto& socket : hot_sockets)
+        threads.emplace_back(hot_client, std::ref(socket));
+    threads.emplace_back(cold_clients, std::ref(cold_sockets), std::cref(cold_stop));
+
+    auto start = clock_type::now();
+    run(ios);
+    std::chrono::duration<double> elapsed = std::min(clock_type::now(), deadline) - start;
+
+    // the sessions closed their sockets: the hot clients fail to write
+    cold_stop = true;
+    for (auto& t : threads)
+        t.join();
+
+    std::cout << std::fixed << std::setprecision(1) << std::setw(17) << std::left << label << std::right;
+    report("hot MB/s", hot_bytes, elapsed.count(), 1e6);
+    report("cold KB/s", cold_bytes, elapsed.count(), 1e3);
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 4)
+        {
+            std::cerr << "Usage: fair_bench <hot> <cold> <milliseconds>" << std::endl;
+            return 1;
+        }
+
+        size_t hot = atoi(argv[1]);
+        size_t cold = atoi(argv[2]);
+        std::chrono::milliseconds duration(atoi(argv[3]));
+
+        // the hot clients write into closed sessions at the end
+        std::signal(SIGPIPE, SIG_IGN);
+
+        measure("queued reads", false, hot, cold, duration);
+
+        for (unsigned limit : {std::numeric_limits<unsigned>::max(), 1024u, 128u, 16u})
+        {
+            coop_budget::set_limit(limit);
+            measure(limit == std::numeric_limits<unsigned>::max()
+                        ? std::string("budget unlimited")
+                        : "budget " + std::to_string(limit),
+                    true, hot, cold, duration);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
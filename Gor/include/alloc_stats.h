@@ -0,0 +1,142 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+// Opt-in heap allocation accounting (CMake option GOR_ALLOC_STATS): alloc_stats.cpp replaces the global operator
+// new/delete and counts every allocation and its bytes in thread-local counters, under the tag of the innermost
+// alloc_tag_scope of the thread. The allocator paths of the adapters are tagged: coroutine frames (coop_promise),
+// future shared states (future_adapter.h), asio operations started by the awaiters (budgeted_awaiter),
+// handler_allocator fallbacks and the asio_future_awaiter timers. Without the option the scopes are empty and
+// nothing is counted.
+enum class alloc_tag : unsigned
+{
+    other,
+    frame,
+    shared_state,
+    io_operation,
+    handler_fallback,
+    timer,
+    count_
+};
+
+constexpr std::size_t alloc_tags = static_cast<std::size_t>(alloc_tag::count_);
+
+inline const char* to_string(alloc_tag tag)
+{
+    constexpr const char* names[alloc_tags] = {
+        "other", "frame", "shared state", "io operation", "handler fallback", "timer"};
+    return names[static_cast<unsigned>(tag)];
+}
+
+// allocations of all the threads, per tag
+struct alloc_totals
+{
+    std::array<std::uint64_t, alloc_tags> allocations{};
+    std::array<std::uint64_t, alloc_tags> bytes{};
+
+    std::uint64_t total_allocations() const
+    {
+        std::uint64_t sum = 0;
+        for (auto n : allocations)
+            sum += n;
+        return sum;
+    }
+
+    std::uint64_t total_bytes() const
+    {
+        std::uint64_t sum = 0;
+        for (auto n : bytes)
+            sum += n;
+        return sum;
+    }
+
+    // "allocations <n> (<bytes> bytes): frame <n>, ..."
+    friend std::ostream& operator<<(std::ostream& os, const alloc_totals& totals)
+    {
+        os << "allocations " << totals.total_allocations() << " (" << totals.total_bytes() << " bytes):";
+        for (std::size_t i = 0; i < alloc_tags; ++i)
+            os << (i ? ", " : " ") << to_string(static_cast<alloc_tag>(i)) << ' ' << totals.allocations[i];
+        return os;
+    }
+};
+
+#if defined(GOR_ALLOC_STATS)
+
+constexpr bool alloc_stats_enabled = true;
+
+// tag of the allocations of this thread
+inline thread_local unsigned current_alloc_tag = 0;
+
+class alloc_tag_scope
+{
+    unsigned previous_;
+
+public:
+    explicit alloc_tag_scope(alloc_tag tag) noexcept
+        : previous_(current_alloc_tag)
+    {
+        current_alloc_tag = static_cast<unsigned>(tag);
+    }
+
+    ~alloc_tag_scope() { current_alloc_tag = previous_; }
+
+    alloc_tag_scope(const alloc_tag_scope&) = delete;
+    alloc_tag_scope& operator=(const alloc_tag_scope&) = delete;
+};
+
+// sums the counters of the live and the finished threads (alloc_stats.cpp)
+alloc_totals alloc_snapshot();
+
+#else
+
+constexpr bool alloc_stats_enabled = false;
+
+class alloc_tag_scope
+{
+public:
+    explicit alloc_tag_scope(alloc_tag) noexcept {}
+    ~alloc_tag_scope() {}
+
+    alloc_tag_scope(const alloc_tag_scope&) = delete;
+    alloc_tag_scope& operator=(const alloc_tag_scope&) = delete;
+};
+
+inline alloc_totals alloc_snapshot() { return {}; }
+
+#endif
+
+// runs make (returning a prvalue) with the allocations tagged: tags the allocations of a member initialization
+template <typename Make>
+auto alloc_tagged(alloc_tag tag, Make make)
+{
+    alloc_tag_scope scope(tag);
+    return make();
+}
+
+// Prints the allocations, and their cost per operation (round trip, connection) if any, when the program counts them
+inline void report_allocations(std::ostream& os, std::uint64_t operations = 0, const char* operation = "round trip")
+{
+    if constexpr (alloc_stats_enabled)
+    {
+        auto totals = alloc_snapshot();
+        os << totals << std::endl;
+
+        if (operations)
+            os << "per " << operation << ": "
+               << static_cast<double>(totals.total_allocations()) / static_cast<double>(operations)
+               << " allocations, "
+               << static_cast<double>(totals.total_bytes()) / static_cast<double>(operations) << " bytes"
+               << std::endl;
+    }
+    else
+    {
+        (void)os;
+        (void)operations;
+        (void)operation;
+    }
+}
+
+#endif // ALLOC_STATS_H
@@ -7,6 +7,8 @@
 #include <asio/system_timer.hpp>
 #include <asio/use_future.hpp>
 
+#include <alloc_stats.h>
+
 // My allocator
 class pre_cpp20_allocator
     : public std::allocator<void>
@@ -47,6 +49,7 @@ class asio_future_awaiter
         {
             // cout << "keep waiting..." << endl;
             // keep waiting
+            alloc_tag_scope scope(alloc_tag::timer);
             t_.expires_from_now(peek_period);
             t_.async_wait([this](const std::error_code& ec){resume_or_wait(ec);});
         }
@@ -0,0 +1,152 @@
+#ifndef ASYNC_SCOPE_H
+#define ASYNC_SCOPE_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <stop_token>
+
+#include <alloc_stats.h>
+#include <await_stats.h>
+#include <scheduler.h>
+#include <trace.h>
+
+// Structured concurrency scope (nursery) owning the coroutines with the signature:
+//   std::future<void> coroutine_name(async_scope&, Args...)
+// The scope counts them while running. request_stop() asks all of them to cancel: the scope token is propagated
+// into their awaiters (see cancellation.h) and co_await get_stop_token() returns it.
+// co_await scope.join() resumes once all of them have finished and their frames are destroyed.
+// A scope is joined once: spawning after join() is not allowed and the scope must outlive the join.
+class async_scope
+{
+    // running coroutines plus one released by join()
+    std::atomic<std::size_t> count_{1};
+    std::stop_source stop_;
+
+    std::coroutine_handle<> joiner_;
+    scheduler* sched_ = nullptr;
+
+    void add() noexcept
+    {
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void remove() noexcept
+    {
+        if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            resume_awaiting(sched_, joiner_);
+    }
+
+public:
+    async_scope() = default;
+    async_scope(const async_scope&) = delete;
+    async_scope& operator=(const async_scope&) = delete;
+
+    std::stop_token get_token() const noexcept
+    {
+        return stop_.get_token();
+    }
+
+    // cancellation is cooperative: the stop callbacks run in the calling thread
+    bool request_stop() noexcept
+    {
+        return stop_.request_stop();
+    }
+
+    bool stop_requested() const noexcept
+    {
+        return stop_.stop_requested();
+    }
+
+    // running coroutines
+    std::size_t size() const noexcept
+    {
+        return count_.load(std::memory_order_relaxed) - 1;
+    }
+
+    auto join() noexcept
+    {
+        struct [[nodiscard]] Awaiter
+        {
+            async_scope& scope_;
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> coro) noexcept
+            {
+                scope_.joiner_ = coro;
+                scope_.sched_ = current_scheduler;
+
+                // already drained
+                return scope_.count_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        return Awaiter{*this};
+    }
+
+    // Promise base of the owned coroutines
+    struct promise_base : coroutine_promise
+    {
+        async_scope& scope;
+
+        template <typename... Args>
+        promise_base(async_scope& s, Args&...) noexcept
+            : scope(s)
+        {
+            stop_token_ = scope.get_token();
+            scope.add();
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            trace_coroutine(trace_event::start, *this);
+            return {};
+        }
+
+        // The frame (and the parameters it owns, like sockets) is destroyed before the scope is notified:
+        // once joined nothing refers to the scope.
+        auto final_suspend() noexcept
+        {
+            trace_coroutine(trace_event::finish, *this);
+
+            struct Awaiter
+            {
+                async_scope& scope_;
+
+                bool await_ready() const noexcept { return false; }
+
+                void await_suspend(std::coroutine_handle<> coro) noexcept
+                {
+                    auto& scope = scope_; // the awaiter is part of the frame
+                    coro.destroy();
+                    scope.remove();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            return Awaiter{scope};
+        }
+    };
+};
+
+template <typename... Args>
+struct std::coroutine_traits<std::future<void>, async_scope&, Args...>
+{
+    struct promise_type : async_scope::promise_base
+    {
+        using promise_base::promise_base;
+
+        std::promise<void> p = alloc_tagged(alloc_tag::shared_state, [] { return std::promise<void>(); });
+        auto get_return_object() { return p.get_future(); }
+        void unhandled_exception() { p.set_exception(std::current_exception()); }
+        void return_void() { p.set_value(); }
+    };
+};
+
+#endif // ASYNC_SCOPE_H
@@ -0,0 +1,358 @@
+#ifndef ASYNC_SYNC_H
+#define ASYNC_SYNC_H
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <scheduler.h>
+
+// Coroutine synchronization primitives.
+// Instead of blocking the thread (and stalling an io_service) the waiting coroutines are suspended. They are resumed
+// on the scheduler where they suspended (see scheduler.h) or inline, in the thread releasing them, if there is none.
+// The state of each primitive is an atomic word plus intrusive lists of the awaiters kept in the coroutine frames:
+// neither locks nor allocations.
+
+// Event that resumes all its waiters once set. It remains set until reset.
+class async_manual_reset_event
+{
+public:
+    class awaiter
+    {
+        friend class async_manual_reset_event;
+
+        async_manual_reset_event& event_;
+        awaiter* next_ = nullptr;
+        std::coroutine_handle<> coro_;
+        scheduler* sched_ = nullptr;
+
+    public:
+        explicit awaiter(async_manual_reset_event& event) noexcept : event_(event) {}
+
+        bool await_ready() const noexcept { return event_.is_set(); }
+
+        bool await_suspend(std::coroutine_handle<> coro) noexcept
+        {
+            coro_ = coro;
+            sched_ = current_scheduler;
+
+            void* old = event_.state_.load(std::memory_order_acquire);
+            do
+            {
+                // set meanwhile
+                if (old == &event_)
+                    return false;
+
+                next_ = static_cast<awaiter*>(old);
+            }
+            while (!event_.state_.compare_exchange_weak(old, this,
+                        std::memory_order_release, std::memory_order_acquire));
+
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    explicit async_manual_reset_event(bool initially_set = false) noexcept
+        : state_(initially_set ? this : nullptr)
+    {
+    }
+
+    async_manual_reset_event(const async_manual_reset_event&) = delete;
+    async_manual_reset_event& operator=(const async_manual_reset_event&) = delete;
+
+    awaiter operator co_await() noexcept { return awaiter{*this}; }
+
+    bool is_set() const noexcept
+    {
+        return state_.load(std::memory_order_acquire) == this;
+    }
+
+    void set() noexcept
+    {
+        void* old = state_.exchange(this, std::memory_order_acq_rel);
+        if (old == this)
+            return;
+
+        for (auto w = static_cast<awaiter*>(old); w;)
+        {
+            auto next = w->next_; // the awaiter is gone once resumed
+            resume_awaiting(w->sched_, w->coro_);
+            w = next;
+        }
+    }
+
+    void reset() noexcept
+    {
+        void* old = this;
+        state_.compare_exchange_strong(old, nullptr, std::memory_order_relaxed);
+    }
+
+private:
+    // `this` when set, otherwise the stack of awaiters (nullptr if none)
+    std::atomic<void*> state_;
+};
+
+class async_mutex;
+
+// RAII owner of a locked async_mutex (see async_mutex::scoped_lock_async())
+class async_mutex_lock
+{
+    async_mutex* mutex_;
+
+public:
+    async_mutex_lock(async_mutex& mutex, std::adopt_lock_t) noexcept : mutex_(&mutex) {}
+
+    async_mutex_lock(async_mutex_lock&& other) noexcept : mutex_(std::exchange(other.mutex_, nullptr)) {}
+
+    async_mutex_lock(const async_mutex_lock&) = delete;
+    async_mutex_lock& operator=(const async_mutex_lock&) = delete;
+
+    inline ~async_mutex_lock();
+};
+
+// Mutex that suspends the contending coroutines. The ownership is handed over in FIFO order.
+// The unlocking coroutine doesn't need to be on the same thread that locked it.
+class async_mutex
+{
+public:
+    class lock_awaiter
+    {
+        friend class async_mutex;
+
+    protected:
+        async_mutex& mutex_;
+
+    private:
+        lock_awaiter* next_ = nullptr;
+        std::coroutine_handle<> coro_;
+        scheduler* sched_ = nullptr;
+
+    public:
+        explicit lock_awaiter(async_mutex& mutex) noexcept : mutex_(mutex) {}
+
+        bool await_ready() noexcept { return mutex_.try_lock(); }
+
+        bool await_suspend(std::coroutine_handle<> coro) noexcept
+        {
+            coro_ = coro;
+            sched_ = current_scheduler;
+
+            auto old = mutex_.state_.load(std::memory_order_acquire);
+            for (;;)
+            {
+                if (old == not_locked)
+                {
+                    // unlocked meanwhile: take it
+                    if (mutex_.state_.compare_exchange_weak(old, locked_no_waiters,
+                            std::memory_order_acquire, std::memory_order_acquire))
+                        return false;
+                }
+                else
+                {
+                    next_ = reinterpret_cast<lock_awaiter*>(old);
+                    if (mutex_.state_.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(this),
+                            std::memory_order_release, std::memory_order_acquire))
+                        return true;
+                }
+            }
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    class scoped_lock_awaiter : public lock_awaiter
+    {
+    public:
+        using lock_awaiter::lock_awaiter;
+
+        [[nodiscard]] async_mutex_lock await_resume() const noexcept
+        {
+            return async_mutex_lock{mutex_, std::adopt_lock};
+        }
+    };
+
+    async_mutex() noexcept = default;
+
+    async_mutex(const async_mutex&) = delete;
+    async_mutex& operator=(const async_mutex&) = delete;
+
+    bool try_lock() noexcept
+    {
+        auto old = not_locked;
+        return state_.compare_exchange_strong(old, locked_no_waiters,
+                std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    // co_await m.lock_async(); ... m.unlock();
+    lock_awaiter lock_async() noexcept { return lock_awaiter{*this}; }
+
+    // auto lock = co_await m.scoped_lock_async();
+    scoped_lock_awaiter scoped_lock_async() noexcept { return scoped_lock_awaiter{*this}; }
+
+    void unlock() noexcept
+    {
+        auto head = waiters_;
+        if (!head)
+        {
+            auto old = locked_no_waiters;
+            if (state_.compare_exchange_strong(old, not_locked,
+                    std::memory_order_release, std::memory_order_relaxed))
+                return;
+
+            // take the newly queued waiters, reversing the stack into FIFO order
+            old = state_.exchange(locked_no_waiters, std::memory_order_acquire);
+            for (auto w = reinterpret_cast<lock_awaiter*>(old); w;)
+            {
+                auto next = w->next_;
+                w->next_ = head;
+                head = w;
+                w = next;
+            }
+        }
+
+        // hand over the ownership
+        waiters_ = head->next_;
+        resume_awaiting(head->sched_, head->coro_);
+    }
+
+private:
+    static constexpr std::uintptr_t not_locked = 1;
+    static constexpr std::uintptr_t locked_no_waiters = 0;
+
+    // not_locked, locked_no_waiters or the stack of awaiters queued since the owner last checked
+    std::atomic<std::uintptr_t> state_{not_locked};
+
+    // FIFO of waiters, only accessed by the owner
+    lock_awaiter* waiters_ = nullptr;
+};
+
+async_mutex_lock::~async_mutex_lock()
+{
+    if (mutex_)
+        mutex_->unlock();
+}
+
+// Counting semaphore that suspends the coroutines waiting for a permit. Permits are handed over in FIFO order.
+class async_semaphore
+{
+public:
+    class acquire_awaiter
+    {
+        friend class async_semaphore;
+
+        async_semaphore& semaphore_;
+        acquire_awaiter* next_ = nullptr;
+        std::coroutine_handle<> coro_;
+        scheduler* sched_ = nullptr;
+
+    public:
+        explicit acquire_awaiter(async_semaphore& semaphore) noexcept : semaphore_(semaphore) {}
+
+        bool await_ready() noexcept { return semaphore_.try_acquire(); }
+
+        bool await_suspend(std::coroutine_handle<> coro) noexcept
+        {
+            coro_ = coro;
+            sched_ = current_scheduler;
+
+            // released meanwhile
+            if (semaphore_.count_.fetch_sub(1, std::memory_order_acquire) > 0)
+                return false;
+
+            // owed a permit: queue for the releasers
+            auto old = semaphore_.incoming_.load(std::memory_order_relaxed);
+            do
+                next_ = old;
+            while (!semaphore_.incoming_.compare_exchange_weak(old, this,
+                        std::memory_order_release, std::memory_order_relaxed));
+
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    explicit async_semaphore(std::ptrdiff_t permits) noexcept : count_(permits) {}
+
+    async_semaphore(const async_semaphore&) = delete;
+    async_semaphore& operator=(const async_semaphore&) = delete;
+
+    bool try_acquire() noexcept
+    {
+        auto old = count_.load(std::memory_order_relaxed);
+        while (old > 0)
+            if (count_.compare_exchange_weak(old, old - 1,
+                    std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+
+        return false;
+    }
+
+    // co_await s.acquire(); ... s.release();
+    acquire_awaiter acquire() noexcept { return acquire_awaiter{*this}; }
+
+    void release(std::ptrdiff_t permits = 1) noexcept
+    {
+        auto old = count_.fetch_add(permits, std::memory_order_release);
+        if (old < 0)
+            wake(static_cast<std::size_t>(std::min(permits, -old)));
+    }
+
+private:
+    // A single releaser at a time resumes waiters: the one taking wakeups_ from 0 drains it back to 0.
+    // Waiters resumed inline that release the semaphore only increment wakeups_, thus there is no recursion.
+    void wake(std::size_t count) noexcept
+    {
+        if (wakeups_.fetch_add(count, std::memory_order_acq_rel) != 0)
+            return;
+
+        do
+        {
+            while (!waiters_)
+            {
+                // take the queued waiters, reversing the stack into FIFO order
+                auto w = incoming_.exchange(nullptr, std::memory_order_acquire);
+                if (!w)
+                {
+                    // the waiter owed is between its decrement and its push
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                while (w)
+                {
+                    auto next = w->next_;
+                    w->next_ = waiters_;
+                    waiters_ = w;
+                    w = next;
+                }
+            }
+
+            auto w = waiters_;
+            waiters_ = w->next_;
+            resume_awaiting(w->sched_, w->coro_);
+        }
+        while (wakeups_.fetch_sub(1, std::memory_order_acq_rel) != 1);
+    }
+
+    // available permits, if negative the number of coroutines owed one
+    std::atomic<std::ptrdiff_t> count_;
+
+    // stack of waiters not yet taken by the releasers
+    std::atomic<acquire_awaiter*> incoming_{nullptr};
+
+    // wakeups requested
+    std::atomic<std::size_t> wakeups_{0};
+
+    // FIFO of waiters, only accessed by the releaser draining wakeups_
+    acquire_awaiter* waiters_ = nullptr;
+};
+
+#endif // ASYNC_SYNC_H
@@ -2,17 +2,160 @@
 #define AWAIT_ADAPTERS
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <coroutine>
 #include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
 
 #include <asio.hpp>
 
+#include <cancellation.h>
 #include <handler_allocator.h>
+#include <metrics.h>
+#include <probes.h>
+#include <scheduler.h>
+
+// Posts a handler to the io_service of an asio io object (get_io_service() was dropped by later asio versions)
+template <typename IoObject, typename Handler>
+void post_to(IoObject& io, Handler&& handler)
+{
+    if constexpr (requires { io.get_io_service(); })
+        io.get_io_service().post(std::forward<Handler>(handler));
+    else
+        asio::post(io.get_executor(), std::forward<Handler>(handler));
+}
+
+// Base of the awaiters that receive the coroutine stop token (see cancellation.h).
+// A stop request cancels the pending operation, which completes with asio::error::operation_aborted.
+// The stop may be requested from any thread: the cancellation is posted to the io_service of the io object, and
+// the operation is cancelled again once started in case the stop came before it existed. With a stop token the
+// coroutine resumes when the last of the completion handler, await_suspend and the posted cancellation is done, so
+// none of them outlives the awaiter or the io object; the awaiters without stop token skip that accounting.
+// The instrumented promises (see await_stats.h) also get the completion time of the operation.
+template <typename IoObject>
+struct cancellable_awaiter
+{
+    struct cancel
+    {
+        cancellable_awaiter& awaiter;
+
+        void operator()() const noexcept { awaiter.post_cancel(); }
+    };
+
+    std::stop_token stop_;
+    std::optional<std::stop_callback<cancel>> on_stop_;
+    std::chrono::steady_clock::time_point* completed_at_ = nullptr;
+
+    // with a stop token only
+    IoObject* io_ = nullptr;
+    scheduler* sched_ = nullptr;
+    std::coroutine_handle<> coro_;
+    std::atomic<int> parties_{0}; // still to finish before the coroutine resumes, 0 when no operation is pending
+
+    cancellable_awaiter() noexcept = default;
+
+    // awaiters may be moved before they are suspended, when no callback is registered yet
+    cancellable_awaiter(cancellable_awaiter&& other) noexcept
+        : stop_(std::move(other.stop_))
+        , completed_at_(other.completed_at_) {}
+
+    void set_stop_token(std::stop_token token) noexcept
+    {
+        stop_ = std::move(token);
+    }
+
+    // registers the cancellation before the operation starts, which must not if already stopped
+    bool cancelled(IoObject& io, std::error_code& ec, std::coroutine_handle<> coro)
+    {
+        if (stop_.stop_possible())
+        {
+            io_ = &io;
+            sched_ = current_scheduler;
+            coro_ = coro;
+
+            // no operation yet: a stop requested until parties_ is set is caught by started()
+            on_stop_.emplace(stop_, cancel{*this});
+            if (stop_.stop_requested())
+            {
+                ec = asio::error::make_error_code(asio::error::operation_aborted);
+                return true;
+            }
+
+            parties_.store(2, std::memory_order_release); // the completion handler and await_suspend
+        }
+
+        metrics::pending_operations.add(1);
+        return false;
+    }
+
+    // end of await_suspend, once the operation started: returns false when the coroutine resumes at once
+    bool started()
+    {
+        if (!on_stop_)
+            return true;
+
+        if (stop_.stop_requested())
+        {
+            asio::error_code ignored;
+            io_->cancel(ignored);
+        }
+
+        return !release();
+    }
+
+    void set_completion_time(std::chrono::steady_clock::time_point* completed_at) noexcept
+    {
+        completed_at_ = completed_at;
+    }
+
+    // completion handler: hands the coroutine back
+    void complete(scheduler* sched, std::coroutine_handle<> coro)
+    {
+        GOR_PROBE1(complete, coro.address());
+        metrics::pending_operations.add(-1);
+        if (completed_at_)
+            *completed_at_ = std::chrono::steady_clock::now();
+
+        if (!on_stop_)
+            resume_awaiting(sched, coro);
+        else if (release())
+            resume_awaiting(sched_, coro_);
+    }
+
+private:
+    // true for the last party
+    bool release() noexcept
+    {
+        return parties_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    // stop callback, on the thread requesting the stop
+    void post_cancel() noexcept
+    {
+        // joins the pending operation, if any
+        int parties = parties_.load(std::memory_order_acquire);
+        while (parties > 0 && !parties_.compare_exchange_weak(parties, parties + 1, std::memory_order_acq_rel))
+            ;
+        if (parties == 0)
+            return;
+
+        post_to(*io_, [this]
+            {
+                asio::error_code ignored;
+                io_->cancel(ignored);
+                if (release())
+                    resume_awaiting(sched_, coro_);
+            });
+    }
+};
 
 template <typename AsyncStream, typename BufferSequence>
 auto async_write(AsyncStream& s, BufferSequence const& buffers)
 {
-    struct [[nodiscard]] Awaiter
+    struct [[nodiscard]] Awaiter : cancellable_awaiter<AsyncStream>
     {
         AsyncStream& s;
         BufferSequence const& buffers;
@@ -30,22 +173,28 @@ auto async_write(AsyncStream& s, BufferSequence const& buffers)
         {
             if (ec)
             {
-                std::cerr << "Error in async_write: " << ec.message() << std::endl;
+                if (ec != asio::error::operation_aborted)
+                    std::cerr << "Error in async_write: " << ec.message() << std::endl;
                 throw std::system_error(ec);
             }
             return n;
         }
 
-        void await_suspend(std::coroutine_handle<> coro)
+        bool await_suspend(std::coroutine_handle<> coro)
         {
+            if (this->cancelled(s, ec, coro))
+                return false;
+
+            auto sched = current_scheduler;
             async_write(s, buffers,
                     make_custom_alloc_handler(alloc,
-                        [this, coro](auto ec, auto n) mutable
+                        [this, coro, sched](auto ec, auto n) mutable
                         {
                             this->n = n;
                             this->ec = ec;
-                            coro.resume();
+                            this->complete(sched, coro);
                         }));
+            return this->started();
         }
     };
 
@@ -55,7 +204,7 @@ auto async_write(AsyncStream& s, BufferSequence const& buffers)
 template <typename AsyncStream, typename BufferSequence>
 auto async_read_some(AsyncStream& s, BufferSequence const& buffers)
 {
-    struct [[nodiscard]] Awaiter
+    struct [[nodiscard]] Awaiter : cancellable_awaiter<AsyncStream>
     {
         AsyncStream& s;
         BufferSequence const& buffers;
@@ -67,29 +216,61 @@ auto async_read_some(AsyncStream& s, BufferSequence const& buffers)
             : s(sp)
             , buffers(bp) {}
 
-        bool await_ready() { return false; }
+        // Sockets in non-blocking mode read synchronously when data is already there, which saves the trip
+        // through the io_service (the coop budget bounds how long a session keeps the thread, see coop.h)
+        bool await_ready()
+        {
+            if constexpr (requires { s.non_blocking(); })
+            {
+                if (s.non_blocking())
+                {
+                    // a stopped session must not keep reading while data is waiting
+                    if (this->stop_.stop_requested())
+                    {
+                        n = 0;
+                        ec = asio::error::make_error_code(asio::error::operation_aborted);
+                        return true;
+                    }
+
+                    asio::error_code error;
+                    n = s.read_some(buffers, error);
+                    if (error == asio::error::would_block)
+                        return false;
+
+                    ec = error;
+                    return true;
+                }
+            }
+
+            return false;
+        }
 
         size_t await_resume()
         {
             if (ec)
             {
-                if (ec != asio::error::eof)
+                if (ec != asio::error::eof && ec != asio::error::operation_aborted)
                     std::cerr << "Error in async_read_some: " << ec.message() << std::endl;
                 throw std::system_error(ec);
             }
             return n;
         }
 
-        void await_suspend(std::coroutine_handle<> coro)
+        bool await_suspend(std::coroutine_handle<> coro)
         {
+            if (this->cancelled(s, ec, coro))
+                return false;
+
+            auto sched = current_scheduler;
             s.async_read_some(buffers,
                     make_custom_alloc_handler(alloc,
-                        [this, coro](auto ec, auto n) mutable
+                        [this, coro, sched](auto ec, auto n) mutable
                         {
                             this->n = n;
                             this->ec = ec;
-                            coro.resume();
+                            this->complete(sched, coro);
                         }));
+            return this->started();
         }
     };
 
@@ -99,7 +280,7 @@ auto async_read_some(AsyncStream& s, BufferSequence const& buffers)
 template <typename AcceptorSocket, typename AsyncStream>
 auto async_accept(AcceptorSocket& a, AsyncStream& s)
 {
-    struct [[nodiscard]] Awaiter
+    struct [[nodiscard]] Awaiter : cancellable_awaiter<AcceptorSocket>
     {
         AcceptorSocket& a;
         AsyncStream& s;
@@ -117,13 +298,19 @@ auto async_accept(AcceptorSocket& a, AsyncStream& s)
                 throw std::system_error(ec);
         }
 
-        void await_suspend(std::coroutine_handle<> coro)
+        bool await_suspend(std::coroutine_handle<> coro)
         {
-            a.async_accept(s, [this, coro](auto ec) mutable
+            if (this->cancelled(a, ec, coro))
+                return false;
+
+            auto sched = current_scheduler;
+            a.async_accept(s, [this, coro, sched](auto ec) mutable
                     {
                         this->ec = ec;
-                        coro.resume();
+                        GOR_PROBE1(accept, ec.value());
+                        this->complete(sched, coro);
                     });
+            return this->started();
         }
     };
 
@@ -135,7 +322,7 @@ auto async_wait(
         asio::basic_waitable_timer<Clock> &t,
         std::chrono::duration<R, P> d)
 {
-    struct [[nodiscard]] Awaiter
+    struct [[nodiscard]] Awaiter : cancellable_awaiter<asio::basic_waitable_timer<Clock>>
     {
         asio::basic_waitable_timer<Clock> &t;
         std::chrono::duration<R, P> d;
@@ -149,20 +336,26 @@ auto async_wait(
                 throw std::system_error(ec);
         }
 
-        void await_suspend(std::coroutine_handle<> coro)
+        bool await_suspend(std::coroutine_handle<> coro)
         {
+            if (this->cancelled(t, ec, coro))
+                return false;
+
+            auto sched = current_scheduler;
             t.expires_from_now(d);
-            t.async_wait([this, coro](auto ec) mutable {this->ec = ec; coro.resume();});
+            t.async_wait([this, coro, sched](auto ec) mutable {this->ec = ec; this->complete(sched, coro);});
+            return this->started();
         }
     };
 
-    return Awaiter{ t, d };
+    return Awaiter{ {}, t, d };
 }
 
+// Connects to the endpoints of a resolver iterator in turn, or to a single endpoint
 template <typename socket_type, typename endpoint_iterator_type>
 auto async_connect(socket_type& socket, endpoint_iterator_type& peer_endpoint)
 {
-    struct [[nodiscard]] Awaiter
+    struct [[nodiscard]] Awaiter : cancellable_awaiter<socket_type>
     {
         socket_type& socket_;
         endpoint_iterator_type& peer_endpoint_;
@@ -176,18 +369,90 @@ auto async_connect(socket_type& socket, endpoint_iterator_type& peer_endpoint)
                 throw std::system_error(ec_);
         }
 
-        void await_suspend(std::coroutine_handle<> coro)
+        bool await_suspend(std::coroutine_handle<> coro)
         {
-            asio::async_connect(socket_, peer_endpoint_,
-                    [this, coro](auto ec, const endpoint_iterator_type&) mutable
-                    {
-                        ec_ = ec;
-                        coro.resume();
-                    });
+            if (this->cancelled(socket_, ec_, coro))
+                return false;
+
+            auto sched = current_scheduler;
+            if constexpr (std::is_same_v<std::remove_cv_t<endpoint_iterator_type>, typename socket_type::endpoint_type>)
+            {
+                // a single endpoint, the socket may be open and bound already (source address)
+                socket_.async_connect(peer_endpoint_,
+                        [this, coro, sched](auto ec) mutable
+                        {
+                            ec_ = ec;
+                            GOR_PROBE1(connect, ec.value());
+                            this->complete(sched, coro);
+                        });
+            }
+            else
+            {
+                asio::async_connect(socket_, peer_endpoint_,
+                        [this, coro, sched](auto ec, const endpoint_iterator_type&) mutable
+                        {
+                            ec_ = ec;
+                            GOR_PROBE1(connect, ec.value());
+                            this->complete(sched, coro);
+                        });
+            }
+            return this->started();
         }
     };
 
-    return Awaiter{socket, peer_endpoint};
+    return Awaiter{ {}, socket, peer_endpoint };
+}
+
+// Queue of an io_service: the coroutines of its io threads yield into it (see coop.h)
+class io_queue final : public scheduler
+{
+    asio::io_service& io_;
+
+public:
+    explicit io_queue(asio::io_service& io) noexcept
+        : io_(io) {}
+
+    void schedule(std::coroutine_handle<> coro) override
+    {
+        io_.post([coro]() mutable
+                {
+                    coro.resume();
+                });
+    }
+};
+
+// io_service run by the calling thread through run() (asio 1.10.8 io_service cannot tell)
+inline thread_local asio::io_service* current_io_service = nullptr;
+
+// Marks the calling thread as an io thread of the io_service while in scope: its coroutines can yield
+// (see reschedule()) and dispatch() into the io_service without going through the queue
+class io_thread
+{
+    io_queue queue_;
+    scheduler* previous_queue_;
+    asio::io_service* previous_io_;
+
+public:
+    explicit io_thread(asio::io_service& io)
+        : queue_(io)
+        , previous_queue_(std::exchange(current_queue, &queue_))
+        , previous_io_(std::exchange(current_io_service, &io)) {}
+
+    io_thread(const io_thread&) = delete;
+    io_thread& operator=(const io_thread&) = delete;
+
+    ~io_thread()
+    {
+        current_queue = previous_queue_;
+        current_io_service = previous_io_;
+    }
+};
+
+// io_service::run() on a marked io thread
+inline std::size_t run(asio::io_service& io)
+{
+    io_thread marker(io);
+    return io.run();
 }
 
 template <typename IOService>
@@ -213,4 +478,64 @@ auto post(IOService& io)
     return Awaiter{ io };
 }
 
+// co_await dispatch(io) makes sure the coroutine runs on a thread of the io_service: it keeps running if it already
+// does (threads started through run()), otherwise it is posted as with resume_on(io).
+inline auto dispatch(asio::io_service& io)
+{
+    struct [[nodiscard]] Awaiter
+    {
+        asio::io_service& io_;
+        handler_allocator alloc;
+
+        // the handler memory is only used by the slow path: not zeroed
+        explicit Awaiter(asio::io_service& io) noexcept
+            : io_(io) {}
+
+        bool await_ready() const noexcept { return current_io_service == &io_; }
+
+        void await_resume() {}
+
+        void await_suspend(std::coroutine_handle<> coro)
+        {
+            io_.post(make_custom_alloc_handler(alloc,
+                        [coro]() mutable
+                        {
+                            coro.resume();
+                        }));
+        }
+    };
+
+    return Awaiter{ io };
+}
+
+// Continues the coroutine on a thread running the io_service (e.g. back from a compute pool, see resume_on(scheduler&)).
+// The handler memory is kept into the awaiter: hopping doesn't allocate.
+inline auto resume_on(asio::io_service& io)
+{
+    struct [[nodiscard]] Awaiter
+    {
+        asio::io_service& io_;
+        handler_allocator alloc;
+
+        // the handler memory is written by the handler: not zeroed on every hop
+        explicit Awaiter(asio::io_service& io) noexcept
+            : io_(io) {}
+
+        bool await_ready() { return false; }
+
+        void await_resume() {}
+
+        void await_suspend(std::coroutine_handle<> coro)
+        {
+            io_.post(make_custom_alloc_handler(alloc,
+                        [coro]() mutable
+                        {
+                            coro.resume();
+                        }));
+        }
+    };
+
+    return Awaiter{ io };
+}
+
 #endif // AWAIT_ADAPTERS
@@ -0,0 +1,255 @@
+#ifndef AWAIT_STATS_H
+#define AWAIT_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <coop.h>
+#include <latency_histogram.h>
+#include <type_name.h>
+
+// Per co_await statistics (CMake option GOR_AWAIT_STATS).
+// instrumented_promise<Base> intercepts every co_await of a coroutine through await_transform (as
+// basics/await/await4.cpp), whose defaulted std::source_location argument is the co_await expression. For each
+// call site and awaiter type it counts the synchronous completions and records into histograms:
+//   suspended    from the suspension to the resumption of the coroutine
+//   resume lag   from the completion of the operation to the resumption (queueing in a scheduler), for the
+//                awaiters reporting their completion time (set_completion_time(), see cancellable_awaiter)
+// The histograms live in per-thread tables: the thread resuming the coroutine records without contention.
+// await_stats::print() merges them at any time. With the option, the adapter promises (future_adapter.h,
+// threadpool.h, async_scope.h) derive from coroutine_promise = instrumented_promise<coop_promise>.
+
+struct await_site
+{
+    const char* file;
+    const char* function;
+    std::uint_least32_t line;
+    const char* awaiter; // typeid name
+
+    bool operator==(const await_site&) const = default;
+};
+
+struct await_site_hash
+{
+    std::size_t operator()(const await_site& site) const noexcept
+    {
+        return std::hash<const void*>()(site.file) ^ (std::hash<const void*>()(site.awaiter) << 1) ^ site.line;
+    }
+};
+
+struct await_site_stats
+{
+    std::uint64_t ready = 0; // completed without suspending
+    latency_histogram suspended;
+    latency_histogram resume_lag;
+
+    void merge(const await_site_stats& other)
+    {
+        ready += other.ready;
+        suspended.merge(other.suspended);
+        resume_lag.merge(other.resume_lag);
+    }
+};
+
+class await_stats
+{
+    // sites recorded by a thread, read by print() under the lock
+    struct table
+    {
+        std::mutex mutex;
+        std::unordered_map<await_site, await_site_stats, await_site_hash> sites;
+    };
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<table>> tables_; // outlive their threads
+
+    static await_stats& get()
+    {
+        static await_stats stats;
+        return stats;
+    }
+
+    static table& this_thread()
+    {
+        static thread_local table& t = []() -> table&
+        {
+            auto& stats = get();
+            std::lock_guard<std::mutex> lock(stats.mutex_);
+            stats.tables_.push_back(std::make_unique<table>());
+            return *stats.tables_.back();
+        }();
+        return t;
+    }
+
+    template <typename F>
+    static void update(const await_site& site, F f)
+    {
+        auto& t = this_thread();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        f(t.sites[site]);
+    }
+
+public:
+    static void record_ready(const await_site& site)
+    {
+        update(site, [](await_site_stats& s) { ++s.ready; });
+    }
+
+    static void record_resume(const await_site& site, std::chrono::nanoseconds suspended,
+                              std::chrono::nanoseconds resume_lag, bool completion_known)
+    {
+        update(site, [&](await_site_stats& s)
+        {
+            s.suspended.record(suspended);
+            if (completion_known)
+                s.resume_lag.record(resume_lag);
+        });
+    }
+
+    // merged statistics of all the threads, by number of co_await
+    static std::vector<std::pair<await_site, await_site_stats>> snapshot()
+    {
+        std::unordered_map<await_site, await_site_stats, await_site_hash> merged;
+        {
+            auto& stats = get();
+            std::lock_guard<std::mutex> lock(stats.mutex_);
+            for (auto& t : stats.tables_)
+            {
+                std::lock_guard<std::mutex> table_lock(t->mutex);
+                for (auto& [site, s] : t->sites)
+                    merged[site].merge(s);
+            }
+        }
+
+        std::vector<std::pair<await_site, await_site_stats>> sites(merged.begin(), merged.end());
+        auto total = [](const await_site_stats& s) { return s.ready + s.suspended.count(); };
+        std::sort(sites.begin(), sites.end(),
+                  [&](const auto& a, const auto& b) { return total(a.second) > total(b.second); });
+        return sites;
+    }
+
+    static void print(std::ostream& os)
+    {
+        auto us = [](std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1000; };
+
+        for (auto& [site, s] : snapshot())
+        {
+            std::string file = site.file;
+            file = file.substr(file.find_last_of("/\\") + 1);
+
+            os << "co_await " << file << ':' << site.line << " (" << brief_type_name(site.awaiter) << "): "
+               << s.ready << " ready, " << s.suspended.count() << " suspended";
+            if (s.suspended.count())
+                os << ", suspended p50 " << us(s.suspended.percentile(50)) << " us p99 "
+                   << us(s.suspended.percentile(99)) << " us";
+            if (s.resume_lag.count())
+                os << ", resume lag p50 " << us(s.resume_lag.percentile(50)) << " us p99 "
+                   << us(s.resume_lag.percentile(99)) << " us";
+            os << std::endl;
+        }
+    }
+};
+
+// Measures an awaiter; holds the awaiter returned by the base promise (by value or by reference)
+template <typename Awaiter, typename Inner>
+class instrumented_awaiter
+{
+    using clock_type = std::chrono::steady_clock;
+
+    Inner inner_;
+    Awaiter& awaiter_; // the awaitable of the co_await, for set_completion_time()
+    await_site site_;
+    clock_type::time_point suspended_at_{};
+    clock_type::time_point completed_at_{};
+
+public:
+    instrumented_awaiter(Inner&& inner, Awaiter& awaiter, const await_site& site)
+        : inner_(std::forward<Inner>(inner))
+        , awaiter_(awaiter)
+        , site_(site)
+    {
+    }
+
+    bool await_ready()
+    {
+        if (!inner_.await_ready())
+            return false;
+
+        await_stats::record_ready(site_);
+        return true;
+    }
+
+    template <typename Promise>
+    decltype(auto) await_suspend(std::coroutine_handle<Promise> coro)
+    {
+        // before: the coroutine may be resumed elsewhere before await_suspend returns
+        if constexpr (requires { awaiter_.set_completion_time(&completed_at_); })
+            awaiter_.set_completion_time(&completed_at_);
+
+        suspended_at_ = clock_type::now();
+        return inner_.await_suspend(coro);
+    }
+
+    decltype(auto) await_resume()
+    {
+        if (suspended_at_ != clock_type::time_point{})
+        {
+            auto now = clock_type::now();
+            bool completion_known = completed_at_ != clock_type::time_point{};
+            await_stats::record_resume(site_, now - suspended_at_, completion_known ? now - completed_at_
+                                                                                    : clock_type::duration{},
+                                       completion_known);
+        }
+
+        return inner_.await_resume();
+    }
+};
+
+// Promise mixin wrapping every co_await of the coroutine into an instrumented_awaiter.
+// Awaitables providing operator co_await are not measured (as in coop_promise).
+template <typename Base>
+struct instrumented_promise : Base
+{
+    using Base::Base;
+
+    template <typename Awaitable>
+    decltype(auto) await_transform(Awaitable&& awaitable,
+                                   std::source_location where = std::source_location::current())
+    {
+        using Inner = decltype(Base::await_transform(std::forward<Awaitable>(awaitable)));
+
+        if constexpr (requires { std::declval<Inner>().await_ready(); })
+        {
+            await_site site{where.file_name(), where.function_name(), where.line(),
+                            typeid(std::remove_cvref_t<Awaitable>).name()};
+            auto& awaiter = awaitable;
+            return instrumented_awaiter<std::remove_reference_t<Awaitable>, Inner>(
+                Base::await_transform(std::forward<Awaitable>(awaitable)), awaiter, site);
+        }
+        else
+            return Base::await_transform(std::forward<Awaitable>(awaitable));
+    }
+};
+
+#if defined(GOR_AWAIT_STATS)
+constexpr bool await_stats_enabled = true;
+using coroutine_promise = instrumented_promise<coop_promise>;
+#else
+constexpr bool await_stats_enabled = false;
+using coroutine_promise = coop_promise;
+#endif
+
+#endif // AWAIT_STATS_H
@@ -0,0 +1,134 @@
+#ifndef BUSY_POLL_H
+#define BUSY_POLL_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include <asio.hpp>
+
+#include <await_adapters.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#endif
+
+// Low latency knobs for the io threads, read once from the environment (unset means off):
+//   GOR_BUSY_POLL_US      spin with non-blocking io_service::poll() calls for this window after the last handler
+//                         before blocking in epoll_wait (run_one())
+//   GOR_SO_BUSY_POLL_US   SO_BUSY_POLL on the sockets: the kernel busy polls the device queue on blocking reads
+//                         (Linux only, values above net.core.busy_read need CAP_NET_ADMIN)
+//   GOR_PIN_THREADS       pin the io thread i to the core i (Linux only)
+// Spinning trades a whole core per io thread for the wake up latency.
+struct busy_poll_config
+{
+    std::chrono::microseconds spin{0};
+    int socket_busy_poll = 0;
+    bool pin_threads = false;
+
+    static const busy_poll_config& get()
+    {
+        static const busy_poll_config config = []
+        {
+            auto number = [](const char* name)
+            {
+                const char* value = std::getenv(name);
+                return value ? std::atoi(value) : 0;
+            };
+
+            busy_poll_config c;
+            c.spin = std::chrono::microseconds(number("GOR_BUSY_POLL_US"));
+            c.socket_busy_poll = number("GOR_SO_BUSY_POLL_US");
+            c.pin_threads = number("GOR_PIN_THREADS") != 0;
+            return c;
+        }();
+
+        return config;
+    }
+};
+
+// process CPU time (all the threads)
+inline double cpu_seconds()
+{
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+inline void pin_this_thread(unsigned core)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % CPU_SETSIZE, &set);
+    if (int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+        std::cerr << "Cannot pin thread to core " << core << ": " << std::strerror(error) << std::endl;
+#else
+    (void)core;
+#endif
+}
+
+// applies GOR_SO_BUSY_POLL_US to a socket
+template <typename Socket>
+void tune_socket(Socket& socket)
+{
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+    if (int usec = busy_poll_config::get().socket_busy_poll)
+    {
+        if (::setsockopt(socket.native_handle(), SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0)
+        {
+            static std::atomic_bool reported{false};
+            if (!reported.exchange(true))
+                std::cerr << "SO_BUSY_POLL: " << std::strerror(errno) << std::endl;
+        }
+    }
+#else
+    (void)socket;
+#endif
+}
+
+// Runs the io_service spinning for the given window after every handler before blocking
+inline std::size_t run_busy_poll(asio::io_service& io, std::chrono::microseconds spin)
+{
+    io_thread marker(io);
+    std::size_t n = 0;
+
+    while (!io.stopped())
+    {
+        auto deadline = std::chrono::steady_clock::now() + spin;
+        while (!io.stopped() && std::chrono::steady_clock::now() < deadline)
+        {
+            if (auto handlers = io.poll())
+            {
+                n += handlers;
+                deadline = std::chrono::steady_clock::now() + spin;
+            }
+        }
+
+        // idle for the whole window
+        if (!io.stopped())
+            n += io.run_one();
+    }
+
+    return n;
+}
+
+// Body of the io thread index: applies the environment knobs
+inline std::size_t run_io_thread(asio::io_service& io, unsigned index)
+{
+    auto& config = busy_poll_config::get();
+
+    if (config.pin_threads)
+        pin_this_thread(index);
+
+    if (config.spin.count() > 0)
+        return run_busy_poll(io, config.spin);
+
+    return run(io);
+}
+
+#endif // BUSY_POLL_H
@@ -0,0 +1,70 @@
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <coroutine>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+// co_await get_stop_token() returns the stop token of the calling coroutine
+// (as winrt::get_cancellation_token() in winrt/winrt_simple_server.cpp)
+struct get_stop_token_t {};
+
+inline get_stop_token_t get_stop_token() noexcept
+{
+    return {};
+}
+
+// Promise mixin that propagates a std::stop_token into every awaiter providing a set_stop_token() member
+// (see await_adapters.h): a stop request cancels the pending operation at once.
+// The token is the first std::stop_token argument of the coroutine, if any.
+struct stop_token_promise
+{
+    std::stop_token stop_token_;
+
+    stop_token_promise() noexcept = default;
+
+    template <typename... Args>
+    explicit stop_token_promise(Args&... args) noexcept
+    {
+        static_cast<void>((take(args) || ...));
+    }
+
+    template <typename Awaitable>
+    Awaitable&& await_transform(Awaitable&& awaitable) noexcept
+    {
+        if constexpr (requires { awaitable.set_stop_token(stop_token_); })
+            awaitable.set_stop_token(stop_token_);
+
+        return std::forward<Awaitable>(awaitable);
+    }
+
+    auto await_transform(get_stop_token_t) noexcept
+    {
+        struct Awaiter
+        {
+            std::stop_token token_;
+
+            bool await_ready() const noexcept { return true; }
+            void await_suspend(std::coroutine_handle<>) const noexcept {}
+            std::stop_token await_resume() noexcept { return std::move(token_); }
+        };
+
+        return Awaiter{stop_token_};
+    }
+
+private:
+    template <typename T>
+    bool take(T& arg) noexcept
+    {
+        if constexpr (std::is_same_v<std::remove_cv_t<T>, std::stop_token>)
+        {
+            stop_token_ = arg;
+            return true;
+        }
+        else
+            return false;
+    }
+};
+
+#endif // CANCELLATION_H
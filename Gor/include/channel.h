@@ -0,0 +1,284 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <async_sync.h>
+
+// Bounded multi-producer multi-consumer channel between coroutines.
+// The values are kept in a lock-free ring buffer (D. Vyukov's bounded MPMC queue). Two async_semaphore count the free
+// slots and the available items:
+// - co_await ch.send(v) suspends while the channel is full (backpressure).
+// - co_await ch.receive() suspends while the channel is empty.
+// The coroutines are resumed on the scheduler where they suspended (see async_sync.h), thus a channel can link
+// coroutines running on an io_service with coroutines running on a threadpool::pool.
+// After close() sends fail and receives drain the remaining values before returning std::nullopt.
+// The capacity is at least 1: there is no unbuffered (rendezvous) channel, channel(0) throws std::invalid_argument.
+template <typename T>
+class channel
+{
+    struct cell
+    {
+        std::atomic<std::size_t> sequence;
+        std::optional<T> value;
+    };
+
+    std::unique_ptr<cell[]> cells_;
+    const std::size_t mask_;
+
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+
+    async_semaphore slots_;
+    async_semaphore items_;
+
+    std::atomic<bool> closed_{false};
+    // sends that passed the closed_ check but haven't pushed yet
+    std::atomic<std::size_t> sending_{0};
+
+    static std::size_t ring_size(std::size_t capacity)
+    {
+        // no rendezvous: a send needs a free slot
+        if (capacity == 0)
+            throw std::invalid_argument("channel capacity must be at least 1");
+
+        std::size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    // Ring buffer operations, they fail if the cell at the position is not ready.
+    // Holding a permit guarantees the cell will be ready as soon as the coroutine that claimed it before publishes it.
+    bool try_push(T& value)
+    {
+        auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& c = cells_[pos & mask_];
+            auto seq = c.sequence.load(std::memory_order_acquire);
+            auto dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (dif == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    c.value.emplace(std::move(value));
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool try_pop(std::optional<T>& value)
+    {
+        auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& c = cells_[pos & mask_];
+            auto seq = c.sequence.load(std::memory_order_acquire);
+            auto dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+
+            if (dif == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(c.value);
+                    c.value.reset();
+                    c.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    // once a slot permit is held
+    bool push(T& value)
+    {
+        sending_.fetch_add(1);
+
+        if (closed_.load())
+        {
+            sending_.fetch_sub(1);
+            return false;
+        }
+
+        while (!try_push(value))
+            std::this_thread::yield();
+
+        sending_.fetch_sub(1, std::memory_order_release);
+        items_.release();
+        return true;
+    }
+
+    // once an item permit is held (or the channel is closed)
+    std::optional<T> pop()
+    {
+        std::optional<T> value;
+        for (;;)
+        {
+            if (try_pop(value))
+                break;
+
+            // closed and no send in progress: one last try
+            if (closed_.load() && sending_.load(std::memory_order_acquire) == 0)
+            {
+                if (try_pop(value))
+                    break;
+                return std::nullopt;
+            }
+
+            std::this_thread::yield();
+        }
+
+        slots_.release();
+        return value;
+    }
+
+public:
+    explicit channel(std::size_t capacity)
+        : cells_(std::make_unique<cell[]>(ring_size(capacity)))
+        , mask_(ring_size(capacity) - 1)
+        , slots_(static_cast<std::ptrdiff_t>(capacity))
+        , items_(0)
+    {
+        for (std::size_t i = 0; i <= mask_; ++i)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    channel(const channel&) = delete;
+    channel& operator=(const channel&) = delete;
+
+    // co_await ch.send(value) returns false if the channel is closed
+    class send_awaiter
+    {
+        channel& ch_;
+        T value_;
+        async_semaphore::acquire_awaiter slot_;
+
+    public:
+        send_awaiter(channel& ch, T&& value)
+            : ch_(ch)
+            , value_(std::move(value))
+            , slot_(ch.slots_)
+        {
+        }
+
+        bool await_ready() noexcept { return slot_.await_ready(); }
+        bool await_suspend(std::coroutine_handle<> coro) noexcept { return slot_.await_suspend(coro); }
+        bool await_resume() { return ch_.push(value_); }
+    };
+
+    // co_await ch.receive() returns std::nullopt once the channel is closed and drained
+    class receive_awaiter
+    {
+    protected:
+        channel& ch_;
+
+    private:
+        async_semaphore::acquire_awaiter item_;
+
+    public:
+        explicit receive_awaiter(channel& ch) noexcept
+            : ch_(ch)
+            , item_(ch.items_)
+        {
+        }
+
+        bool await_ready() noexcept { return item_.await_ready(); }
+        bool await_suspend(std::coroutine_handle<> coro) noexcept { return item_.await_suspend(coro); }
+        std::optional<T> await_resume() { return ch_.pop(); }
+    };
+
+    // co_await ch.receive_batch(values, max) waits for a value and then takes up to max values
+    // without suspending. Returns how many were appended to values, 0 once closed and drained.
+    class receive_batch_awaiter : public receive_awaiter
+    {
+        std::vector<T>& values_;
+        std::size_t max_;
+
+    public:
+        receive_batch_awaiter(channel& ch, std::vector<T>& values, std::size_t max) noexcept
+            : receive_awaiter(ch)
+            , values_(values)
+            , max_(max)
+        {
+        }
+
+        std::size_t await_resume()
+        {
+            auto& ch = this->ch_;
+            auto value = ch.pop();
+            if (!value)
+                return 0;
+
+            std::size_t count = 0;
+            do
+            {
+                values_.push_back(std::move(*value));
+                ++count;
+            }
+            while (count < max_ && ch.items_.try_acquire() && (value = ch.pop()));
+
+            return count;
+        }
+    };
+
+    [[nodiscard]] send_awaiter send(T value) { return send_awaiter{*this, std::move(value)}; }
+
+    [[nodiscard]] receive_awaiter receive() noexcept { return receive_awaiter{*this}; }
+
+    [[nodiscard]] receive_batch_awaiter receive_batch(std::vector<T>& values, std::size_t max) noexcept
+    {
+        return receive_batch_awaiter{*this, values, max};
+    }
+
+    // non suspending counterparts
+    bool try_send(T value)
+    {
+        return slots_.try_acquire() && push(value);
+    }
+
+    std::optional<T> try_receive()
+    {
+        if (!items_.try_acquire())
+            return std::nullopt;
+        return pop();
+    }
+
+    // Wakes all the waiting coroutines: permits are released so that nobody suspends anymore.
+    void close() noexcept
+    {
+        if (closed_.exchange(true))
+            return;
+
+        constexpr auto unlimited = std::numeric_limits<std::ptrdiff_t>::max() / 2;
+        slots_.release(unlimited);
+        items_.release(unlimited);
+    }
+
+    bool closed() const noexcept
+    {
+        return closed_.load();
+    }
+};
+
+#endif // CHANNEL_H
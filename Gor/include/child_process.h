@@ -0,0 +1,158 @@
+#ifndef CHILD_PROCESS_H
+#define CHILD_PROCESS_H
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+extern char** environ;
+
+// Child processes of the benchmark drivers (echo_bench, c100k_bench): the servers under test. POSIX only.
+
+inline double cpu_seconds(const rusage& usage)
+{
+    auto seconds = [](const timeval& tv) { return static_cast<double>(tv.tv_sec) + tv.tv_usec / 1e6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+// CPU time and resident memory of a running process, from /proc (Linux, 0 elsewhere)
+inline double process_cpu_seconds(pid_t pid)
+{
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string field;
+    double ticks = 0;
+    // fields 14 and 15: utime and stime (the name, field 2, has no space for the benchmarks)
+    for (int i = 1; i <= 15 && in >> field; ++i)
+        if (i >= 14)
+            ticks += std::stod(field);
+    return ticks / static_cast<double>(::sysconf(_SC_CLK_TCK));
+}
+
+inline std::size_t process_resident_bytes(pid_t pid)
+{
+    std::ifstream in("/proc/" + std::to_string(pid) + "/statm");
+    std::size_t size = 0, resident = 0;
+    in >> size >> resident;
+    return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+class child
+{
+    pid_t pid_ = -1;      // -1 once reaped
+    int status_ = 0;      // of the reaped child
+    rusage usage_{};
+
+    // reaps the child if it exited (or waits for it): pid_ is then cleared, never to be signalled again
+    bool reap(int options)
+    {
+        int result;
+        while ((result = ::wait4(pid_, &status_, options, &usage_)) < 0 && errno == EINTR)
+            ;
+        if (result == 0)
+            return false;
+
+        pid_ = -1;
+        return true;
+    }
+
+public:
+    // runs path with args, stdout and stderr go to the output file
+    child(const std::vector<std::string>& args, const std::string& output)
+    {
+        std::vector<char*> argv;
+        for (auto& arg : args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+        int error = posix_spawn(&pid_, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (error)
+            throw std::system_error(error, std::generic_category(), args[0]);
+    }
+
+    child(const child&) = delete;
+    child& operator=(const child&) = delete;
+
+    ~child()
+    {
+        if (pid_ > 0)
+        {
+            ::kill(pid_, SIGKILL);
+            wait();
+        }
+    }
+
+    // reaps the child when it exited early (e.g. the port was in use)
+    bool running()
+    {
+        return pid_ > 0 && !reap(WNOHANG);
+    }
+
+    void interrupt()
+    {
+        if (pid_ > 0)
+            ::kill(pid_, SIGINT);
+    }
+
+    // CPU time of the child
+    double wait()
+    {
+        if (pid_ > 0)
+            reap(0);
+        return ::cpu_seconds(usage_);
+    }
+
+    // wait status, once reaped
+    int status() const { return status_; }
+
+    // while it runs (Linux, 0 elsewhere)
+    double cpu_seconds() const { return process_cpu_seconds(pid_); }
+    std::size_t resident_bytes() const { return process_resident_bytes(pid_); }
+};
+
+// waits until the server accepts connections
+inline bool wait_listening(child& server, const std::string& address, unsigned short port)
+{
+    sockaddr_in endpoint{};
+    endpoint.sin_family = AF_INET;
+    endpoint.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.c_str(), &endpoint.sin_addr) != 1)
+        throw std::invalid_argument("not an IPv4 address: " + address);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline && server.running())
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        bool connected = ::connect(fd, reinterpret_cast<sockaddr*>(&endpoint), sizeof(endpoint)) == 0;
+        ::close(fd);
+        if (connected)
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+#endif // CHILD_PROCESS_H
@@ -0,0 +1,188 @@
+#ifndef COOP_H
+#define COOP_H
+
+#include <atomic>
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+
+#include <alloc_stats.h>
+#include <cancellation.h>
+#include <scheduler.h>
+#include <trace.h>
+
+// Cooperative scheduling budget (as the tokio coop budget).
+// Awaiters completing synchronously (e.g. an uncontended async_mutex, a non empty channel or a socket read with
+// data already there) keep the coroutine running: a session that always has data ready would never give the others
+// a turn. Each thread may run a limited number of synchronous completions, then the coroutine yields: it goes through
+// the queue of the thread (its scheduler or its io_service, see run() in await_adapters.h) behind the ready work.
+// The budget is refilled whenever a coroutine suspends or yields.
+class coop_budget
+{
+    static constexpr unsigned default_limit = 128;
+
+    static inline std::atomic<unsigned> limit_{default_limit};
+    static inline thread_local unsigned remaining_ = default_limit;
+
+public:
+    // synchronous completions between two trips through the queue
+    static unsigned limit() noexcept
+    {
+        return limit_.load(std::memory_order_relaxed);
+    }
+
+    static void set_limit(unsigned limit) noexcept
+    {
+        limit_.store(limit, std::memory_order_relaxed);
+        remaining_ = limit;
+    }
+
+    static void refill() noexcept
+    {
+        remaining_ = limit();
+    }
+
+    // false once exhausted
+    static bool consume() noexcept
+    {
+        if (remaining_ == 0)
+            return false;
+
+        --remaining_;
+        return true;
+    }
+};
+
+// Reschedules the coroutine behind the ready work of the calling thread.
+// Returns false if the thread has no queue: the caller keeps running.
+inline bool yield_thread(std::coroutine_handle<> coro)
+{
+    scheduler* sched = current_scheduler ? current_scheduler : current_queue;
+
+    coop_budget::refill();
+    if (!sched)
+        return false;
+
+    sched->yield(coro);
+    return true;
+}
+
+// co_await reschedule() gives the other coroutines of the thread a turn
+inline auto reschedule() noexcept
+{
+    struct [[nodiscard]] Awaiter
+    {
+        bool await_ready() const noexcept { return !current_scheduler && !current_queue; }
+
+        bool await_suspend(std::coroutine_handle<> coro)
+        {
+            return yield_thread(coro);
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    return Awaiter{};
+}
+
+// Charges the synchronous completions of an awaiter to the coop budget
+template <typename Awaiter>
+class budgeted_awaiter
+{
+    Awaiter& awaiter_;
+    bool yield_ = false;
+    [[no_unique_address]] trace_suspension<Awaiter> trace_;
+
+public:
+    explicit budgeted_awaiter(Awaiter& awaiter) noexcept
+        : awaiter_(awaiter) {}
+
+    bool await_ready()
+    {
+        if (!awaiter_.await_ready())
+            return false;
+
+        if (coop_budget::consume())
+            return true;
+
+        // completed, but the others get a turn first
+        yield_ = true;
+        return false;
+    }
+
+    template <typename Promise>
+    auto await_suspend(std::coroutine_handle<Promise> coro)
+    {
+        using result_type = decltype(awaiter_.await_suspend(coro));
+
+        trace_.suspend(coro);
+
+        if constexpr (std::is_void_v<result_type> || std::is_same_v<result_type, bool>)
+        {
+            if (yield_)
+                return yield_thread(coro);
+
+            if constexpr (std::is_void_v<result_type>)
+            {
+                alloc_tag_scope scope(alloc_tag::io_operation);
+                awaiter_.await_suspend(coro);
+            }
+            else if (alloc_tag_scope scope(alloc_tag::io_operation); !awaiter_.await_suspend(coro))
+                return coop_budget::consume() ? false : yield_thread(coro);
+
+            // suspended: the awaiter may already be gone
+            coop_budget::refill();
+            return true;
+        }
+        else
+        {
+            if (yield_)
+                return yield_thread(coro) ? std::noop_coroutine() : std::coroutine_handle<>(coro);
+
+            coop_budget::refill();
+            alloc_tag_scope scope(alloc_tag::io_operation);
+            return std::coroutine_handle<>(awaiter_.await_suspend(coro));
+        }
+    }
+
+    decltype(auto) await_resume()
+    {
+        trace_.resume();
+        return awaiter_.await_resume();
+    }
+};
+
+// Promise mixin of the coroutines: propagates the stop token (see cancellation.h) and charges the awaiters to the
+// coop budget. Awaitables providing operator co_await are not charged.
+struct coop_promise : stop_token_promise
+{
+    using stop_token_promise::stop_token_promise;
+    using stop_token_promise::await_transform;
+
+    template <typename Awaitable>
+    decltype(auto) await_transform(Awaitable&& awaitable) noexcept
+    {
+        auto&& transformed = stop_token_promise::await_transform(std::forward<Awaitable>(awaitable));
+
+        if constexpr (requires { transformed.await_ready(); })
+            return budgeted_awaiter<std::remove_reference_t<Awaitable>>(transformed);
+        else
+            return std::forward<Awaitable>(transformed);
+    }
+
+#if defined(GOR_ALLOC_STATS)
+    // tags the coroutine frames
+    static void* operator new(std::size_t size)
+    {
+        alloc_tag_scope scope(alloc_tag::frame);
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* pointer, std::size_t size) noexcept
+    {
+        ::operator delete(pointer, size);
+    }
+#endif
+};
+
+#endif // COOP_H
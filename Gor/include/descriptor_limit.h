@@ -0,0 +1,43 @@
+#ifndef DESCRIPTOR_LIMIT_H
+#define DESCRIPTOR_LIMIT_H
+
+#include <sys/resource.h>
+
+#include <cstddef>
+#include <iostream>
+
+// descriptors kept for the program itself (standard streams, io_service, acceptors, ...)
+constexpr std::size_t reserved_descriptors = 64;
+
+// Raises the open files limit to the hard limit (the child processes inherit it) and returns how many of the given
+// sessions fit in it, each using descriptors_per_session; the sessions beyond are reported and dropped.
+// POSIX only.
+inline std::size_t raise_descriptor_limit(std::size_t sessions, std::size_t descriptors_per_session = 2)
+{
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return sessions;
+
+    if (limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    if (limit.rlim_cur == RLIM_INFINITY)
+        return sessions;
+
+    std::size_t descriptors = static_cast<std::size_t>(limit.rlim_cur);
+    std::size_t available =
+        descriptors > reserved_descriptors ? (descriptors - reserved_descriptors) / descriptors_per_session : 0;
+    if (sessions > available)
+    {
+        std::cerr << "descriptor limit " << descriptors << " only allows " << available
+                  << " sessions: raise the hard limit (ulimit -Hn)" << std::endl;
+        sessions = available;
+    }
+
+    return sessions;
+}
+
+#endif // DESCRIPTOR_LIMIT_H
@@ -0,0 +1,581 @@
+#ifndef EPOLL_REACTOR_H
+#define EPOLL_REACTOR_H
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <scheduler.h>
+
+// Experimental Linux reactor purpose-built for coroutines (no asio).
+// Every socket owns a slot registered once into an edge-triggered epoll instance. The awaiters try the system call
+// first and only on EAGAIN park themselves into the slot: the reactor retries the call when epoll reports the edge and
+// queues the coroutine handle once it completes. The ready coroutines are resumed in batches after each epoll_wait().
+// The awaiters mirror the await_adapters.h API (async_read_some, async_write, async_accept, async_connect), but
+// async_read_some returns 0 at end of stream instead of throwing asio::error::eof.
+// A reactor is run by a single thread; other threads may only schedule coroutines into it.
+// Sockets must outlive their pending operations: as in the examples, the coroutine frame owns them.
+namespace epoll
+{
+    [[noreturn]] inline void throw_errno(int error)
+    {
+        throw std::system_error(error, std::system_category());
+    }
+
+    // pending operation parked into a slot: the reactor calls perform() on every readiness edge
+    struct operation
+    {
+        std::coroutine_handle<> coro;
+        bool (*perform)(operation&) noexcept; // false to keep waiting
+    };
+
+    struct slot
+    {
+        int fd = -1;
+        bool writable = false; // EPOLLOUT registered
+        operation* reader = nullptr;
+        operation* writer = nullptr;
+    };
+
+    class reactor final : public scheduler
+    {
+        static constexpr int max_events = 256;
+
+        int epoll_fd_;
+        int wake_fd_;
+
+        // coroutines to resume in the next batch
+        std::vector<std::coroutine_handle<>> ready_;
+        std::vector<std::coroutine_handle<>> batch_;
+        std::size_t waiting_ = 0;
+
+        // scheduled from other threads
+        std::mutex mutex_;
+        std::vector<std::coroutine_handle<>> remote_;
+        std::atomic<bool> stop_{false};
+
+        static inline thread_local reactor* running_ = nullptr;
+
+        void take(operation*& op)
+        {
+            if (op && op->perform(*op))
+            {
+                ready_.push_back(op->coro);
+                op = nullptr;
+                --waiting_;
+            }
+        }
+
+    public:
+        reactor()
+            : epoll_fd_(::epoll_create1(EPOLL_CLOEXEC))
+            , wake_fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        {
+            if (epoll_fd_ < 0 || wake_fd_ < 0)
+                throw_errno(errno);
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLET;
+            event.data.ptr = nullptr; // wake ups
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) < 0)
+                throw_errno(errno);
+        }
+
+        reactor(const reactor&) = delete;
+        reactor& operator=(const reactor&) = delete;
+
+        ~reactor()
+        {
+            ::close(wake_fd_);
+            ::close(epoll_fd_);
+        }
+
+        bool running_in_this_thread() const noexcept
+        {
+            return running_ == this;
+        }
+
+        void schedule(std::coroutine_handle<> coro) override
+        {
+            if (running_in_this_thread())
+                return ready_.push_back(coro);
+
+            {
+                std::lock_guard lock(mutex_);
+                remote_.push_back(coro);
+            }
+
+            std::uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(wake_fd_, &one, sizeof(one));
+        }
+
+        void stop()
+        {
+            stop_ = true;
+
+            std::uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(wake_fd_, &one, sizeof(one));
+        }
+
+        // Registers a non-blocking descriptor. As asio, EPOLLOUT is only added once a write would block:
+        // otherwise every ACK freeing send buffer space reports an edge nobody waits for.
+        void add(int fd, slot& s)
+        {
+            s.fd = fd;
+            s.writable = false;
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+            event.data.ptr = &s;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0)
+                throw_errno(errno);
+        }
+
+        // parks an operation until its descriptor is readable
+        void wait_readable(slot& s, operation& op) noexcept
+        {
+            s.reader = &op;
+            ++waiting_;
+        }
+
+        // parks an operation until its descriptor is writable (an already writable one reports an edge at once)
+        void wait_writable(slot& s, operation& op) noexcept
+        {
+            if (!s.writable)
+            {
+                epoll_event event{};
+                event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                event.data.ptr = &s;
+                ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, s.fd, &event);
+                s.writable = true;
+            }
+
+            s.writer = &op;
+            ++waiting_;
+        }
+
+        // Returns once stopped or when no coroutine is ready nor waiting for a descriptor
+        // (coroutines scheduled from other threads must be accounted for by the caller).
+        void run()
+        {
+            auto previous_running = std::exchange(running_, this);
+            auto previous_queue = std::exchange(current_queue, this);
+
+            std::array<epoll_event, max_events> events;
+
+            while (!stop_.load(std::memory_order_relaxed))
+            {
+                {
+                    std::lock_guard lock(mutex_);
+                    ready_.insert(ready_.end(), remote_.begin(), remote_.end());
+                    remote_.clear();
+                }
+
+                if (ready_.empty() && waiting_ == 0)
+                    break;
+
+                int n = ::epoll_wait(epoll_fd_, events.data(), max_events, ready_.empty() ? -1 : 0);
+                if (n < 0 && errno != EINTR)
+                    throw_errno(errno);
+
+                for (int i = 0; i < n; ++i)
+                {
+                    auto s = static_cast<slot*>(events[i].data.ptr);
+                    if (!s)
+                    {
+                        std::uint64_t count;
+                        [[maybe_unused]] auto r = ::read(wake_fd_, &count, sizeof(count));
+                        continue;
+                    }
+
+                    auto flags = events[i].events;
+                    if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                        take(s->reader);
+                    if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+                        take(s->writer);
+                }
+
+                // resume the batch: the coroutines may park operations or schedule more of them
+                batch_.swap(ready_);
+                for (auto coro : batch_)
+                    coro.resume();
+                batch_.clear();
+            }
+
+            current_queue = previous_queue;
+            running_ = previous_running;
+        }
+    };
+
+    struct const_buffer
+    {
+        const void* data;
+        std::size_t size;
+    };
+
+    struct mutable_buffer
+    {
+        void* data;
+        std::size_t size;
+    };
+
+    inline mutable_buffer buffer(void* data, std::size_t size) noexcept
+    {
+        return {data, size};
+    }
+
+    inline const_buffer buffer(const void* data, std::size_t size) noexcept
+    {
+        return {data, size};
+    }
+
+    // IPv4 endpoint from a dotted address
+    inline sockaddr_in endpoint(const char* address, unsigned short port)
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (::inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument), address);
+
+        return addr;
+    }
+
+    // Non-blocking TCP descriptor registered into a reactor
+    class socket
+    {
+        reactor* reactor_;
+        int fd_ = -1;
+        std::unique_ptr<slot> slot_ = std::make_unique<slot>(); // registered address: sockets can move
+
+    public:
+        explicit socket(reactor& r) noexcept
+            : reactor_(&r) {}
+
+        socket(socket&& other) noexcept
+            : reactor_(other.reactor_)
+            , fd_(std::exchange(other.fd_, -1))
+            , slot_(std::move(other.slot_)) {}
+
+        socket& operator=(socket&& other) noexcept
+        {
+            close();
+            reactor_ = other.reactor_;
+            fd_ = std::exchange(other.fd_, -1);
+            slot_ = std::move(other.slot_);
+            return *this;
+        }
+
+        ~socket()
+        {
+            close();
+        }
+
+        // takes ownership of a non-blocking descriptor
+        void assign(int fd)
+        {
+            close();
+            fd_ = fd;
+            reactor_->add(fd_, *slot_);
+        }
+
+        void open()
+        {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+                throw_errno(errno);
+
+            assign(fd);
+        }
+
+        void close() noexcept
+        {
+            if (fd_ >= 0)
+                ::close(fd_);
+            fd_ = -1;
+        }
+
+        void set_no_delay(bool on)
+        {
+            int value = on;
+            if (::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) < 0)
+                throw_errno(errno);
+        }
+
+        int native_handle() const noexcept { return fd_; }
+        reactor& get_reactor() const noexcept { return *reactor_; }
+        slot& get_slot() const noexcept { return *slot_; }
+    };
+
+    // Listening TCP socket
+    class acceptor
+    {
+        socket socket_;
+
+    public:
+        acceptor(reactor& r, const sockaddr_in& addr, int backlog = SOMAXCONN)
+            : socket_(r)
+        {
+            socket_.open();
+
+            int fd = socket_.native_handle();
+            int reuse = 1;
+            if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0
+                || ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0
+                || ::listen(fd, backlog) < 0)
+                throw_errno(errno);
+        }
+
+        int native_handle() const noexcept { return socket_.native_handle(); }
+        reactor& get_reactor() const noexcept { return socket_.get_reactor(); }
+        slot& get_slot() const noexcept { return socket_.get_slot(); }
+    };
+
+    // Common part of the awaiters: the first attempt happens in await_ready(), so operations completing at once
+    // don't suspend (and are charged to the coop budget, see coop.h)
+    template <typename Derived>
+    struct io_awaiter : operation
+    {
+        int error = 0;
+
+        static bool attempt(operation& op) noexcept
+        {
+            return static_cast<Derived&>(op).try_complete();
+        }
+
+        io_awaiter() noexcept
+            : operation{{}, &attempt} {}
+
+        bool await_ready() noexcept
+        {
+            return static_cast<Derived*>(this)->try_complete();
+        }
+
+        // errno of the last attempt: true if it is done
+        bool failed(int code) noexcept
+        {
+            if (code == EAGAIN || code == EWOULDBLOCK || code == EINPROGRESS)
+                return false;
+            if (code == EINTR)
+                return static_cast<Derived*>(this)->try_complete();
+
+            error = code;
+            return true;
+        }
+
+        void check() const
+        {
+            if (error)
+                throw_errno(error);
+        }
+    };
+
+    inline auto async_read_some(socket& s, mutable_buffer b)
+    {
+        struct [[nodiscard]] Awaiter : io_awaiter<Awaiter>
+        {
+            socket& s;
+            mutable_buffer b;
+            std::size_t n = 0;
+
+            Awaiter(socket& sp, mutable_buffer bp) noexcept
+                : s(sp)
+                , b(bp) {}
+
+            bool try_complete() noexcept
+            {
+                auto r = ::recv(s.native_handle(), b.data, b.size, 0);
+                if (r < 0)
+                    return this->failed(errno);
+
+                n = static_cast<std::size_t>(r);
+                return true;
+            }
+
+            void await_suspend(std::coroutine_handle<> coro) noexcept
+            {
+                this->coro = coro;
+                s.get_reactor().wait_readable(s.get_slot(), *this);
+            }
+
+            // 0 at end of stream
+            std::size_t await_resume()
+            {
+                this->check();
+                return n;
+            }
+        };
+
+        return Awaiter{s, b};
+    }
+
+    inline auto async_write(socket& s, const_buffer b)
+    {
+        struct [[nodiscard]] Awaiter : io_awaiter<Awaiter>
+        {
+            socket& s;
+            const_buffer b;
+            std::size_t n = 0;
+
+            Awaiter(socket& sp, const_buffer bp) noexcept
+                : s(sp)
+                , b(bp) {}
+
+            // the whole buffer
+            bool try_complete() noexcept
+            {
+                while (n < b.size)
+                {
+                    auto r = ::send(s.native_handle(), static_cast<const char*>(b.data) + n, b.size - n, MSG_NOSIGNAL);
+                    if (r < 0)
+                        return this->failed(errno);
+
+                    n += static_cast<std::size_t>(r);
+                }
+
+                return true;
+            }
+
+            void await_suspend(std::coroutine_handle<> coro) noexcept
+            {
+                this->coro = coro;
+                s.get_reactor().wait_writable(s.get_slot(), *this);
+            }
+
+            std::size_t await_resume()
+            {
+                this->check();
+                return n;
+            }
+        };
+
+        return Awaiter{s, b};
+    }
+
+    inline auto async_write(socket& s, mutable_buffer b)
+    {
+        return async_write(s, const_buffer{b.data, b.size});
+    }
+
+    inline auto async_accept(acceptor& a, socket& s)
+    {
+        struct [[nodiscard]] Awaiter : io_awaiter<Awaiter>
+        {
+            acceptor& a;
+            socket& s;
+
+            Awaiter(acceptor& ap, socket& sp) noexcept
+                : a(ap)
+                , s(sp) {}
+
+            bool try_complete() noexcept
+            {
+                int fd = ::accept4(a.native_handle(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0)
+                    return this->failed(errno);
+
+                try
+                {
+                    s.assign(fd);
+                }
+                catch (std::system_error& e)
+                {
+                    ::close(fd);
+                    error = e.code().value();
+                }
+
+                return true;
+            }
+
+            void await_suspend(std::coroutine_handle<> coro) noexcept
+            {
+                this->coro = coro;
+                a.get_reactor().wait_readable(a.get_slot(), *this);
+            }
+
+            void await_resume()
+            {
+                this->check();
+            }
+        };
+
+        return Awaiter{a, s};
+    }
+
+    inline auto async_connect(socket& s, const sockaddr_in& peer)
+    {
+        struct [[nodiscard]] Awaiter : io_awaiter<Awaiter>
+        {
+            socket& s;
+            const sockaddr_in& peer;
+            bool started = false;
+
+            Awaiter(socket& sp, const sockaddr_in& pp) noexcept
+                : s(sp)
+                , peer(pp) {}
+
+            bool try_complete() noexcept
+            {
+                if (!started)
+                {
+                    started = true;
+                    if (::connect(s.native_handle(), reinterpret_cast<const sockaddr*>(&peer), sizeof(peer)) < 0)
+                        return this->failed(errno);
+
+                    return true;
+                }
+
+                // writable: the connection completed or failed
+                socklen_t length = sizeof(error);
+                if (::getsockopt(s.native_handle(), SOL_SOCKET, SO_ERROR, &error, &length) < 0)
+                    error = errno;
+                if (error)
+                    return true;
+
+                // an unconnected socket also reports EPOLLOUT | EPOLLHUP once registered
+                sockaddr_in address{};
+                length = sizeof(address);
+                if (::getpeername(s.native_handle(), reinterpret_cast<sockaddr*>(&address), &length) < 0)
+                    return this->failed(errno == ENOTCONN ? EINPROGRESS : errno);
+
+                return true;
+            }
+
+            void await_suspend(std::coroutine_handle<> coro) noexcept
+            {
+                this->coro = coro;
+                s.get_reactor().wait_writable(s.get_slot(), *this);
+            }
+
+            void await_resume()
+            {
+                this->check();
+            }
+        };
+
+        if (s.native_handle() < 0)
+            s.open();
+
+        return Awaiter{s, peer};
+    }
+
+} // namespace epoll
+
+#endif // EPOLL_REACTOR_H
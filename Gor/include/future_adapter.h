@@ -4,15 +4,21 @@
 #include <coroutine>
 #include <future>
 
+#include <alloc_stats.h>
+#include <await_stats.h>
+#include <trace.h>
+
 template <typename... Args>
 struct std::coroutine_traits<std::future<void>, Args...>
 {
-  struct promise_type
+  struct promise_type : coroutine_promise
   {
-    std::promise<void> p;
+    using coroutine_promise::coroutine_promise;
+
+    std::promise<void> p = alloc_tagged(alloc_tag::shared_state, [] { return std::promise<void>(); });
     auto get_return_object() { return p.get_future(); }
-    std::suspend_never initial_suspend() { return {}; }
-    std::suspend_never final_suspend() noexcept { return {}; }
+    std::suspend_never initial_suspend() { trace_coroutine(trace_event::start, *this); return {}; }
+    std::suspend_never final_suspend() noexcept { trace_coroutine(trace_event::finish, *this); return {}; }
     void set_exception(std::exception_ptr e) { p.set_exception(std::move(e)); }
     void unhandled_exception() { p.set_exception(std::current_exception()); }
     void return_void() { p.set_value(); }
@@ -22,12 +28,14 @@ struct std::coroutine_traits<std::future<void>, Args...>
 template <typename R, typename... Args>
 struct std::coroutine_traits<std::future<R>, Args...>
 {
-  struct promise_type
+  struct promise_type : coroutine_promise
   {
-    std::promise<R> p;
+    using coroutine_promise::coroutine_promise;
+
+    std::promise<R> p = alloc_tagged(alloc_tag::shared_state, [] { return std::promise<R>(); });
     auto get_return_object() { return p.get_future(); }
-    std::suspend_never initial_suspend() { return {}; }
-    std::suspend_never final_suspend() noexcept { return {}; }
+    std::suspend_never initial_suspend() { trace_coroutine(trace_event::start, *this); return {}; }
+    std::suspend_never final_suspend() noexcept { trace_coroutine(trace_event::finish, *this); return {}; }
     void set_exception(std::exception_ptr e) { p.set_exception(std::move(e)); }
     void unhandled_exception() { p.set_exception(std::current_exception()); }
     template <typename U> void return_value(U &&u) { p.set_value(std::forward<U>(u)); }
@@ -3,6 +3,9 @@
 
 #include <array>
 
+#include <alloc_stats.h>
+#include <probes.h>
+
 // Class to manage the memory to be used for handler-based custom allocation.
 // It contains a single block of memory which may be returned for allocation
 // requests. If the memory is in use when an allocation request is made, the
@@ -54,8 +57,14 @@ template <class T> struct SimpleAllocator
       throw std::bad_alloc();
 
     void* result = my_alloc.allocate(bytes);
-    if (!result)
+    if (result)
+      GOR_PROBE1(handler_alloc_hit, bytes);
+    else
+    {
+      GOR_PROBE1(handler_alloc_miss, bytes);
+      alloc_tag_scope scope(alloc_tag::handler_fallback);
       result = operator new(bytes);
+    }
     return static_cast<T*>(result);
   }
 
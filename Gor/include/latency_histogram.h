@@ -0,0 +1,115 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Log-linear latency histogram (as HdrHistogram with 3 significant bits): every power of two of nanoseconds is
+// split into 8 buckets, so a percentile is reported within 12.5%. Recording is a few instructions and the
+// histograms of several sessions or threads are merged at the end.
+class latency_histogram
+{
+    static constexpr unsigned sub_bits = 3;
+    static constexpr unsigned sub_buckets = 1u << sub_bits;
+    static constexpr unsigned octaves = 40; // up to 2^40 ns (about 18 minutes), longer ones are clamped
+
+    static constexpr unsigned buckets = (octaves + 1) * sub_buckets;
+
+    std::array<std::uint64_t, buckets> counts_{};
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t max_ = 0;
+
+    static unsigned bucket(std::uint64_t ns) noexcept
+    {
+        if (ns < sub_buckets)
+            return static_cast<unsigned>(ns);
+
+        unsigned shift = static_cast<unsigned>(std::bit_width(ns)) - 1 - sub_bits;
+        if (shift >= octaves)
+            return buckets - 1;
+
+        return (shift + 1) * sub_buckets + static_cast<unsigned>((ns >> shift) & (sub_buckets - 1));
+    }
+
+    // highest value of a bucket
+    static std::uint64_t upper_bound(unsigned index) noexcept
+    {
+        if (index < sub_buckets)
+            return index;
+
+        unsigned shift = index / sub_buckets - 1;
+        std::uint64_t sub = index % sub_buckets;
+        return ((sub_buckets + sub + 1) << shift) - 1;
+    }
+
+public:
+    void record(std::chrono::nanoseconds latency) noexcept
+    {
+        auto ns = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(latency.count(), 0));
+
+        ++counts_[bucket(ns)];
+        ++count_;
+        sum_ += ns;
+        max_ = std::max(max_, ns);
+    }
+
+    void merge(const latency_histogram& other) noexcept
+    {
+        for (std::size_t i = 0; i < counts_.size(); ++i)
+            counts_[i] += other.counts_[i];
+
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    std::uint64_t count() const noexcept { return count_; }
+
+    std::chrono::nanoseconds max() const noexcept
+    {
+        return std::chrono::nanoseconds(max_);
+    }
+
+    std::chrono::nanoseconds mean() const noexcept
+    {
+        return std::chrono::nanoseconds(count_ ? sum_ / count_ : 0);
+    }
+
+    // p in [0, 100]
+    std::chrono::nanoseconds percentile(double p) const noexcept
+    {
+        if (count_ == 0)
+            return {};
+
+        auto rank = static_cast<std::uint64_t>(p / 100 * static_cast<double>(count_ - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (unsigned i = 0; i < buckets; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+                return std::chrono::nanoseconds(std::min(upper_bound(i), max_));
+        }
+
+        return max();
+    }
+
+    // one line summary in microseconds
+    friend std::ostream& operator<<(std::ostream& os, const latency_histogram& h)
+    {
+        auto us = [](std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1000; };
+
+        return os << h.count() << " samples, mean " << us(h.mean())
+                  << " us, p50 " << us(h.percentile(50))
+                  << " us, p90 " << us(h.percentile(90))
+                  << " us, p99 " << us(h.percentile(99))
+                  << " us, p99.9 " << us(h.percentile(99.9))
+                  << " us, max " << us(h.max()) << " us";
+    }
+};
+
+#endif // LATENCY_HISTOGRAM_H
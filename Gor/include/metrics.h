@@ -0,0 +1,232 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <alloc_stats.h>
+
+// Live runtime metrics: counters, gauges and histograms updated from the hot paths and aggregated on demand
+// (see metrics_endpoint.h for the text endpoint).
+// Every thread updates its own shard, a fixed array of slots, with relaxed loads and stores (no locked
+// instruction, no contention); render() sums the shards of all the threads, which are kept after their thread
+// exits. A gauge is the sum of the increments and decrements of all the threads, so it may go up on one thread
+// and down on another.
+namespace metrics
+{
+    constexpr std::size_t max_scalars = 64;
+    constexpr std::size_t max_histograms = 16;
+    constexpr std::size_t histogram_buckets = 65; // bucket i: values of bit width i (powers of two)
+
+    enum class kind
+    {
+        counter,
+        gauge,
+        histogram
+    };
+
+    struct shard
+    {
+        struct histogram_slots
+        {
+            std::array<std::atomic<std::uint64_t>, histogram_buckets> counts{};
+            std::atomic<std::uint64_t> sum{0};
+        };
+
+        std::array<std::atomic<std::int64_t>, max_scalars> scalars{};
+        std::array<histogram_slots, max_histograms> histograms{};
+        shard* next = nullptr;
+    };
+
+    // single writer: the owner thread
+    template <typename T, typename U>
+    void add(std::atomic<T>& slot, U n) noexcept
+    {
+        slot.store(slot.load(std::memory_order_relaxed) + static_cast<T>(n), std::memory_order_relaxed);
+    }
+
+    class registry
+    {
+        struct descriptor
+        {
+            std::string name;
+            std::string help;
+            metrics::kind type;
+            std::size_t slot;
+        };
+
+        mutable std::mutex mutex_; // registration and rendering only
+        std::vector<descriptor> descriptors_;
+        std::size_t scalars_ = 0;
+        std::size_t histograms_ = 0;
+        std::atomic<shard*> shards_{nullptr};
+
+        shard& add_shard()
+        {
+            auto s = new shard; // lives as long as the process, as the metrics of its thread
+            s->next = shards_.load(std::memory_order_relaxed);
+            while (!shards_.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed))
+                ;
+            return *s;
+        }
+
+        template <typename F>
+        void for_each_shard(F f) const
+        {
+            for (auto s = shards_.load(std::memory_order_acquire); s; s = s->next)
+                f(*s);
+        }
+
+        static void header(std::ostream& os, const std::string& name, const std::string& help, const char* type)
+        {
+            os << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+        }
+
+    public:
+        static registry& get()
+        {
+            static registry r;
+            return r;
+        }
+
+        shard& this_thread()
+        {
+            static thread_local shard& s = add_shard();
+            return s;
+        }
+
+        // returns the slot of the new metric
+        std::size_t add(std::string name, std::string help, metrics::kind type)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            auto& count = type == kind::histogram ? histograms_ : scalars_;
+            if (count == (type == kind::histogram ? max_histograms : max_scalars))
+                throw std::length_error("too many metrics: " + name);
+
+            descriptors_.push_back({std::move(name), std::move(help), type, count});
+            return count++;
+        }
+
+        // Prometheus text format
+        std::string render() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::ostringstream os;
+
+            for (auto& d : descriptors_)
+            {
+                if (d.type != kind::histogram)
+                {
+                    std::int64_t value = 0;
+                    for_each_shard([&](const shard& s) { value += s.scalars[d.slot].load(std::memory_order_relaxed); });
+
+                    header(os, d.name, d.help, d.type == kind::counter ? "counter" : "gauge");
+                    os << d.name << ' ' << value << '\n';
+                    continue;
+                }
+
+                std::array<std::uint64_t, histogram_buckets> counts{};
+                std::uint64_t sum = 0;
+                for_each_shard([&](const shard& s)
+                {
+                    auto& h = s.histograms[d.slot];
+                    for (std::size_t i = 0; i < histogram_buckets; ++i)
+                        counts[i] += h.counts[i].load(std::memory_order_relaxed);
+                    sum += h.sum.load(std::memory_order_relaxed);
+                });
+
+                header(os, d.name, d.help, "histogram");
+                std::size_t last = histogram_buckets;
+                while (last > 1 && counts[last - 1] == 0)
+                    --last;
+
+                std::uint64_t cumulative = 0;
+                for (std::size_t i = 0; i < last && i < 64; ++i)
+                {
+                    cumulative += counts[i];
+                    os << d.name << "_bucket{le=\"" << ((std::uint64_t(1) << i) - 1) << "\"} " << cumulative << '\n';
+                }
+                for (std::size_t i = std::min<std::size_t>(last, 64); i < histogram_buckets; ++i)
+                    cumulative += counts[i];
+                os << d.name << "_bucket{le=\"+Inf\"} " << cumulative << '\n'
+                   << d.name << "_sum " << sum << '\n'
+                   << d.name << "_count " << cumulative << '\n';
+            }
+
+            // counted when built with GOR_ALLOC_STATS
+            if constexpr (alloc_stats_enabled)
+            {
+                auto totals = alloc_snapshot();
+                header(os, "gor_allocations_total", "Heap allocations", "counter");
+                os << "gor_allocations_total " << totals.total_allocations() << '\n';
+                header(os, "gor_allocated_bytes_total", "Heap allocated bytes", "counter");
+                os << "gor_allocated_bytes_total " << totals.total_bytes() << '\n';
+            }
+
+            return os.str();
+        }
+    };
+
+    // monotonic count, e.g. bytes read
+    class counter
+    {
+        std::size_t slot_;
+
+    public:
+        counter(std::string name, std::string help)
+            : slot_(registry::get().add(std::move(name), std::move(help), kind::counter)) {}
+
+        void add(std::uint64_t n = 1) noexcept
+        {
+            metrics::add(registry::get().this_thread().scalars[slot_], n);
+        }
+    };
+
+    // current level, e.g. open sessions
+    class gauge
+    {
+        std::size_t slot_;
+
+    public:
+        gauge(std::string name, std::string help)
+            : slot_(registry::get().add(std::move(name), std::move(help), kind::gauge)) {}
+
+        void add(std::int64_t n) noexcept
+        {
+            metrics::add(registry::get().this_thread().scalars[slot_], n);
+        }
+    };
+
+    // distribution in power of two buckets, e.g. bytes per read
+    class histogram
+    {
+        std::size_t slot_;
+
+    public:
+        histogram(std::string name, std::string help)
+            : slot_(registry::get().add(std::move(name), std::move(help), kind::histogram)) {}
+
+        void record(std::uint64_t value) noexcept
+        {
+            auto& h = registry::get().this_thread().histograms[slot_];
+            metrics::add(h.counts[std::bit_width(value)], 1);
+            metrics::add(h.sum, value);
+        }
+    };
+
+    // asio operations started by the await_adapters.h awaiters and not completed yet: the io queue depth
+    inline gauge pending_operations("gor_pending_operations", "Asynchronous operations in progress");
+
+} // namespace metrics
+
+#endif // METRICS_H
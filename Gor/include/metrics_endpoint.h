@@ -0,0 +1,92 @@
+#ifndef METRICS_ENDPOINT_H
+#define METRICS_ENDPOINT_H
+
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+
+#include <asio.hpp>
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <await_adapters.h>
+#include <future_adapter.h>
+#include <metrics.h>
+
+// Text endpoint of the metrics registry (metrics.h), served by coroutines on the io_service of the program:
+// every connection gets an HTTP/1.0 response with the metrics in the Prometheus text format, whatever the request
+// (curl http://127.0.0.1:<port>/metrics, or curl --unix-socket <path> http://localhost/metrics).
+template <typename Socket>
+std::future<void> metrics_request(Socket socket)
+{
+    char request[1024];
+
+    try
+    {
+        // the request itself doesn't matter
+        co_await async_read_some(socket, asio::buffer(request, sizeof(request)));
+
+        std::string body = metrics::registry::get().render();
+        std::string response = "HTTP/1.0 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n"
+                               "\r\n" + body;
+
+        co_await async_write(socket, asio::buffer(response));
+    }
+    catch (std::exception&)
+    {
+        // the scraper went away
+    }
+}
+
+template <typename Acceptor>
+std::future<void> serve_metrics(asio::io_service& ios, Acceptor acceptor)
+{
+    // nobody waits for the endpoint: an accept error stops it and is reported here
+    try
+    {
+        for (;;)
+        {
+            typename Acceptor::protocol_type::socket socket(ios);
+            co_await async_accept(acceptor, socket);
+            metrics_request(std::move(socket));
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "metrics endpoint: " << e.what() << std::endl;
+    }
+}
+
+// Starts the endpoint configured in the environment (unset means none):
+//   GOR_METRICS_PORT     TCP port on 127.0.0.1
+//   GOR_METRICS_SOCKET   path of a Unix socket (POSIX)
+inline void start_metrics_endpoint(asio::io_service& ios)
+{
+    if (const char* port = std::getenv("GOR_METRICS_PORT"))
+    {
+        asio::ip::tcp::endpoint endpoint(asio::ip::address_v4::loopback(), static_cast<unsigned short>(std::atoi(port)));
+        serve_metrics(ios, asio::ip::tcp::acceptor(ios, endpoint));
+        std::cout << "metrics on http://" << endpoint << "/metrics" << std::endl;
+    }
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    if (const char* path = std::getenv("GOR_METRICS_SOCKET"))
+    {
+        // a socket left over by a previous run, never another file
+        struct stat st;
+        if (::stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+            ::unlink(path);
+        serve_metrics(ios, asio::local::stream_protocol::acceptor(ios, asio::local::stream_protocol::endpoint(path)));
+        std::cout << "metrics on unix socket " << path << std::endl;
+    }
+#endif
+}
+
+#endif // METRICS_ENDPOINT_H
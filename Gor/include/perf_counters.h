@@ -0,0 +1,194 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <ostream>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#define GOR_HAS_PERF_EVENTS 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+// Hardware counters of the process over the measured window of a benchmark (perf_event_open, Linux), when
+// GOR_PERF_COUNTERS is set in the environment: cycles, instructions, cache misses, branch misses and context
+// switches, reported in total and per operation with the IPC.
+// The counters are opened with the inherit bit: start() before the io threads are created, they count the threads
+// too. Each counter is a separate event (the kernel multiplexes them when it runs out of hardware counters, the
+// values are scaled by the time they ran). When perf_event_paranoid forbids counting the kernel, they count the
+// user space only; the events the machine has no counter for (virtual machines without a PMU) are reported n/a.
+class perf_counters
+{
+public:
+    struct counter
+    {
+        const char* name;
+        std::uint32_t type;
+        std::uint64_t config;
+        int fd = -1;
+        std::optional<double> value;
+    };
+
+private:
+#if defined(GOR_HAS_PERF_EVENTS)
+    std::array<counter, 5> counters_{{
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1, {}},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1, {}},
+        {"cache misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1, {}},
+        {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1, {}},
+        {"context switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, -1, {}},
+    }};
+#else
+    std::array<counter, 0> counters_{};
+#endif
+    bool started_ = false;
+    bool user_only_ = false;
+
+#if defined(GOR_HAS_PERF_EVENTS)
+    static int open(const counter& c, bool exclude_kernel)
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = c.type;
+        attr.config = c.config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = exclude_kernel;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // this process, any cpu
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+    std::optional<double> find(const char* name) const
+    {
+        for (auto& c : counters_)
+            if (std::strcmp(c.name, name) == 0)
+                return c.value;
+        return std::nullopt;
+    }
+
+public:
+    static bool enabled()
+    {
+        static const bool enabled = std::getenv("GOR_PERF_COUNTERS") != nullptr;
+        return enabled;
+    }
+
+    perf_counters() = default;
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    ~perf_counters()
+    {
+#if defined(GOR_HAS_PERF_EVENTS)
+        for (auto& c : counters_)
+            if (c.fd >= 0)
+                ::close(c.fd);
+#endif
+    }
+
+    // opens and starts the counters, when enabled
+    void start()
+    {
+        if (!enabled())
+            return;
+
+#if defined(GOR_HAS_PERF_EVENTS)
+        for (auto& c : counters_)
+        {
+            c.fd = open(c, user_only_);
+            if (c.fd < 0 && (errno == EACCES || errno == EPERM) && !user_only_)
+            {
+                user_only_ = true;
+                c.fd = open(c, user_only_);
+            }
+        }
+
+        for (auto& c : counters_)
+            if (c.fd >= 0)
+                ::ioctl(c.fd, PERF_EVENT_IOC_ENABLE, 0);
+        started_ = true;
+#else
+        std::cerr << "GOR_PERF_COUNTERS: perf_event_open is not available" << std::endl;
+#endif
+    }
+
+    // stops the counters and reads them
+    void stop()
+    {
+        if (!started_)
+            return;
+
+#if defined(GOR_HAS_PERF_EVENTS)
+        for (auto& c : counters_)
+        {
+            if (c.fd < 0)
+                continue;
+
+            ::ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+            std::uint64_t values[3] = {}; // value, time enabled, time running
+            if (::read(c.fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)))
+                continue;
+
+            if (values[2] > 0)
+                c.value = static_cast<double>(values[0]) * static_cast<double>(values[1]) /
+                          static_cast<double>(values[2]);
+            else
+                c.value = 0.0;
+        }
+#endif
+        started_ = false;
+    }
+
+    // totals and per operation (round trip) values, after stop()
+    void print(std::ostream& os, std::uint64_t operations, const char* operation = "round trip") const
+    {
+        if (!enabled() || counters_.empty())
+            return;
+
+        auto list = [&](double divisor)
+        {
+            const char* separator = "";
+            for (auto& c : counters_)
+            {
+                os << separator;
+                separator = ", ";
+                if (c.value)
+                    os << *c.value / divisor << ' ' << c.name;
+                else
+                    os << c.name << " n/a";
+            }
+        };
+
+        os << "counters" << (user_only_ ? " (user space)" : "") << ": ";
+        list(1);
+        auto cycles = find("cycles");
+        auto instructions = find("instructions");
+        if (cycles && instructions && *cycles > 0)
+            os << ", IPC " << *instructions / *cycles;
+        os << std::endl;
+
+        if (operations)
+        {
+            os << "per " << operation << ": ";
+            list(static_cast<double>(operations));
+            os << std::endl;
+        }
+    }
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,37 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT static probes (provider "gor") for bpftrace/perf on a running program, see the scripts in bpftrace/.
+// Without a tracer attached a probe is a nop instruction; where <sys/sdt.h> is missing (or GOR_NO_PROBES is
+// defined) the probes compile to nothing.
+//   suspend(frame, awaiter)    a coroutine suspends in an awaiter (typeid name of the awaiter)
+//   resume(frame, awaiter)     the coroutine resumes
+//   complete(frame)            an asio operation completed, the coroutine is handed back to its scheduler
+//   accept(error)              async_accept completed (error code value, 0 on success)
+//   connect(error)             async_connect completed
+//   handler_alloc_hit(size)    handler memory served by the handler_allocator block
+//   handler_alloc_miss(size)   the block was in use or too small: heap allocation
+//   session_start(fd)          a client or server session starts
+//   session_end(fd)            the session ends
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>) && !defined(GOR_NO_PROBES)
+#define GOR_HAS_PROBES 1
+#endif
+#endif
+
+#if defined(GOR_HAS_PROBES)
+
+#include <sys/sdt.h>
+
+#define GOR_PROBE1(name, a) DTRACE_PROBE1(gor, name, a)
+#define GOR_PROBE2(name, a, b) DTRACE_PROBE2(gor, name, a, b)
+
+#else
+
+#define GOR_PROBE1(name, a) static_cast<void>(a)
+#define GOR_PROBE2(name, a, b) (static_cast<void>(a), static_cast<void>(b))
+
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,61 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <coroutine>
+
+// Execution context for coroutines resumed by the await_adapters.h awaiters.
+// The awaiters record the scheduler of the thread where the coroutine suspends and hand the coroutine
+// back to it once the asynchronous operation completes (as winrt resumes into the awaiting apartment).
+// Threads without a scheduler (e.g. io_service threads) resume the coroutine inline in the completion handler.
+struct scheduler
+{
+    virtual void schedule(std::coroutine_handle<> coro) = 0;
+
+    // Reschedules a running coroutine behind the other ready ones (see coop.h)
+    virtual void yield(std::coroutine_handle<> coro)
+    {
+        schedule(coro);
+    }
+
+protected:
+    ~scheduler() = default;
+};
+
+// scheduler owning the calling thread, set by the scheduler's worker threads
+inline thread_local scheduler* current_scheduler = nullptr;
+
+// Queue of a thread without scheduler, e.g. the io_service of an io thread (see run() in await_adapters.h).
+// Only used to yield (see coop.h): the awaiters still resume the coroutines inline on such threads.
+inline thread_local scheduler* current_queue = nullptr;
+
+inline void resume_awaiting(scheduler* sched, std::coroutine_handle<> coro)
+{
+    if (sched)
+        sched->schedule(coro);
+    else
+        coro.resume();
+}
+
+// co_await resume_on(sched) continues the coroutine on the scheduler (e.g. to offload CPU work into a thread pool).
+// From then on the await_adapters.h awaiters resume it there too.
+inline auto resume_on(scheduler& sched) noexcept
+{
+    struct [[nodiscard]] Awaiter
+    {
+        scheduler& sched_;
+
+        // already there
+        bool await_ready() const noexcept { return current_scheduler == &sched_; }
+
+        void await_resume() const noexcept {}
+
+        void await_suspend(std::coroutine_handle<> coro)
+        {
+            sched_.schedule(coro);
+        }
+    };
+
+    return Awaiter{ sched };
+}
+
+#endif // SCHEDULER_H
@@ -0,0 +1,289 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <alloc_stats.h>
+#include <await_stats.h>
+#include <scheduler.h>
+#include <trace.h>
+
+// Portable counterpart of winrt/threadpool_winrt.h: a work-stealing thread pool whose
+// coroutines always resume on it.
+namespace threadpool
+{
+    // Work-stealing pool of coroutine handles
+    // Each worker owns a deque: it pushes and pops at the back (LIFO, the most recently
+    // scheduled coroutine frame is likely still in cache) while idle workers steal from
+    // the front (FIFO, the oldest work).
+    class pool final : public scheduler
+    {
+        pool(pool const &) = delete;
+        pool & operator=(pool const &) = delete;
+
+        struct worker
+        {
+            std::mutex mutex;
+            std::deque<std::coroutine_handle<>> tasks;
+            std::atomic<std::size_t> executed{0};
+            std::atomic<std::size_t> steals{0};
+        };
+
+        std::vector<std::unique_ptr<worker>> workers_;
+        std::vector<std::thread> threads_;
+
+        std::atomic<std::size_t> pending_{0};
+        std::atomic<std::size_t> next_{0};
+        std::atomic<unsigned> sleepers_{0};
+        std::atomic<bool> stop_{false};
+        std::mutex sleep_mutex_;
+        std::condition_variable sleep_;
+
+        // worker index of the calling thread if it belongs to this pool
+        static inline thread_local std::size_t index_ = 0;
+
+        bool pop(std::size_t self, std::coroutine_handle<>& task)
+        {
+            {
+                auto& own = *workers_[self];
+                std::lock_guard lock(own.mutex);
+                if (!own.tasks.empty())
+                {
+                    task = own.tasks.back();
+                    own.tasks.pop_back();
+                    pending_.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            for (std::size_t i = 1; i < workers_.size(); ++i)
+            {
+                auto& victim = *workers_[(self + i) % workers_.size()];
+                std::lock_guard lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    task = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    pending_.fetch_sub(1, std::memory_order_relaxed);
+                    workers_[self]->steals.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void run(std::size_t self)
+        {
+            current_scheduler = this;
+            index_ = self;
+
+            std::coroutine_handle<> task;
+            while (!stop_.load(std::memory_order_acquire))
+            {
+                if (pop(self, task))
+                {
+                    task.resume();
+                    workers_[self]->executed.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                // nothing to do: sleep until new work is submitted
+                std::unique_lock lock(sleep_mutex_);
+                sleepers_.fetch_add(1);
+                sleep_.wait(lock, [this]{ return stop_.load() || pending_.load() > 0; });
+                sleepers_.fetch_sub(1);
+            }
+
+            current_scheduler = nullptr;
+        }
+
+    public:
+
+        explicit pool(unsigned threads)
+        {
+            if (threads == 0)
+                threads = 1;
+
+            for (unsigned i = 0; i < threads; ++i)
+                workers_.push_back(std::make_unique<worker>());
+
+            for (unsigned i = 0; i < threads; ++i)
+                threads_.emplace_back(&pool::run, this, i);
+        }
+
+        // pending coroutines are not resumed (as io_service::stop())
+        ~pool()
+        {
+            {
+                std::lock_guard lock(sleep_mutex_);
+                stop_ = true;
+            }
+            sleep_.notify_all();
+
+            for (auto& t : threads_)
+                t.join();
+        }
+
+        // Queue a coroutine for resumption. Workers push into their own deque,
+        // other threads spread the work round robin.
+        void submit(std::coroutine_handle<> coro)
+        {
+            std::size_t target = running_in_this_thread()
+                ? index_
+                : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+            // counted before it is published: a pop() of it must not run the counter below zero
+            pending_.fetch_add(1);
+            {
+                auto& w = *workers_[target];
+                std::lock_guard lock(w.mutex);
+                w.tasks.push_back(coro);
+            }
+
+            if (sleepers_.load() > 0)
+            {
+                std::lock_guard lock(sleep_mutex_);
+                sleep_.notify_one();
+            }
+        }
+
+        void schedule(std::coroutine_handle<> coro) override
+        {
+            submit(coro);
+        }
+
+        // Workers push the yielding coroutine at the front of their deque: it resumes after the local work
+        // (or when stolen).
+        void yield(std::coroutine_handle<> coro) override
+        {
+            if (!running_in_this_thread())
+                return submit(coro);
+
+            pending_.fetch_add(1);
+            {
+                auto& w = *workers_[index_];
+                std::lock_guard lock(w.mutex);
+                w.tasks.push_front(coro);
+            }
+
+            if (sleepers_.load() > 0)
+            {
+                std::lock_guard lock(sleep_mutex_);
+                sleep_.notify_one();
+            }
+        }
+
+        bool running_in_this_thread() const noexcept
+        {
+            return current_scheduler == this;
+        }
+
+        unsigned size() const noexcept
+        {
+            return static_cast<unsigned>(workers_.size());
+        }
+
+        // statistics
+        std::size_t executed() const noexcept
+        {
+            std::size_t n = 0;
+            for (auto& w : workers_)
+                n += w->executed.load(std::memory_order_relaxed);
+            return n;
+        }
+
+        std::size_t steals() const noexcept
+        {
+            std::size_t n = 0;
+            for (auto& w : workers_)
+                n += w->steals.load(std::memory_order_relaxed);
+            return n;
+        }
+
+        // co_await pool.schedule() resumes the coroutine on a worker thread
+        auto schedule() noexcept
+        {
+            struct [[nodiscard]] Awaiter
+            {
+                pool& p;
+
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> coro) { p.submit(coro); }
+                void await_resume() const noexcept {}
+            };
+
+            return Awaiter{*this};
+        }
+    };
+
+    // Promise base for coroutines with the signature:
+    //   std::future<T> coroutine_name(threadpool::pool&, Args...)
+    // The body starts on the pool, from then on the await_adapters.h awaiters resume it on the pool
+    // (the workers are the current_scheduler of their threads).
+    struct pool_promise : coroutine_promise
+    {
+        threadpool::pool& tp_pool;
+
+        template <typename... Args>
+        pool_promise(threadpool::pool& p, Args&... args)
+            : coroutine_promise(args...)
+            , tp_pool(p)
+        {
+        }
+
+        auto initial_suspend() noexcept
+        {
+            trace_coroutine(trace_event::start, *this);
+            return traced_awaiter(tp_pool.schedule());
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            trace_coroutine(trace_event::finish, *this);
+            return {};
+        }
+    };
+
+} // namespace threadpool
+
+template <typename... Args>
+struct std::coroutine_traits<std::future<void>, threadpool::pool&, Args...>
+{
+    struct promise_type : threadpool::pool_promise
+    {
+        using pool_promise::pool_promise;
+
+        std::promise<void> p = alloc_tagged(alloc_tag::shared_state, [] { return std::promise<void>(); });
+        auto get_return_object() { return p.get_future(); }
+        void unhandled_exception() { p.set_exception(std::current_exception()); }
+        void return_void() { p.set_value(); }
+    };
+};
+
+template <typename R, typename... Args>
+struct std::coroutine_traits<std::future<R>, threadpool::pool&, Args...>
+{
+    struct promise_type : threadpool::pool_promise
+    {
+        using pool_promise::pool_promise;
+
+        std::promise<R> p = alloc_tagged(alloc_tag::shared_state, [] { return std::promise<R>(); });
+        auto get_return_object() { return p.get_future(); }
+        void unhandled_exception() { p.set_exception(std::current_exception()); }
+        template <typename U> void return_value(U &&u) { p.set_value(std::forward<U>(u)); }
+    };
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,292 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <probes.h>
+#include <type_name.h>
+
+// Coroutine tracing (CMake option GOR_TRACE, compiled out otherwise).
+// The promises record when a coroutine starts and finishes (initial/final_suspend), the awaiters when it suspends
+// and resumes (budgeted_awaiter in coop.h). An event is a TSC read and a store into a per-thread ring buffer: only
+// the owner thread writes its ring, which keeps the last GOR_TRACE_EVENTS events (default 65536).
+// At exit the rings are written to GOR_TRACE_FILE (default gor_trace.json) in the Chrome trace format
+// (chrome://tracing, ui.perfetto.dev): a slice per run of a coroutine on a thread and an async span, named after
+// the awaiter, per suspension.
+enum class trace_event : std::uint32_t
+{
+    start,
+    suspend,
+    resume,
+    finish
+};
+
+#if defined(GOR_TRACE)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+constexpr bool trace_enabled = true;
+
+// time stamp counter, steady_clock where there is none
+inline std::uint64_t trace_clock() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+class trace_ring
+{
+public:
+    struct event
+    {
+        std::uint64_t ticks;
+        const void* frame;
+        const char* name;
+        trace_event kind;
+    };
+
+    explicit trace_ring(std::size_t capacity)
+        : events_(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+        , mask_(events_.size() - 1)
+    {
+    }
+
+    // owner thread only
+    void record(trace_event kind, const void* frame, const char* name) noexcept
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        events_[head & mask_] = {trace_clock(), frame, name, kind};
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // the events still in the ring, oldest first
+    template <typename F>
+    void for_each(F f) const
+    {
+        auto head = head_.load(std::memory_order_acquire);
+        auto first = head > events_.size() ? head - events_.size() : 0;
+        for (auto i = first; i < head; ++i)
+            f(events_[i & mask_]);
+    }
+
+private:
+    std::vector<event> events_;
+    std::size_t mask_;
+    std::atomic<std::uint64_t> head_{0};
+};
+
+// Owns the rings (they outlive their threads) and writes them at exit
+class trace_registry
+{
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<trace_ring>> rings_;
+    std::uint64_t start_ticks_ = trace_clock();
+    std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+
+    static std::string escape(const std::string& s)
+    {
+        std::string escaped;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+public:
+    static trace_registry& get()
+    {
+        static trace_registry registry;
+        return registry;
+    }
+
+    ~trace_registry()
+    {
+        const char* path = std::getenv("GOR_TRACE_FILE");
+        dump(path ? path : "gor_trace.json");
+    }
+
+    trace_ring& add_thread()
+    {
+        const char* events = std::getenv("GOR_TRACE_EVENTS");
+        auto ring = std::make_unique<trace_ring>(events ? std::strtoul(events, nullptr, 10) : 65536);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.push_back(std::move(ring));
+        return *rings_.back();
+    }
+
+    // Chrome trace JSON of the recorded events; expects the traced threads to be idle
+    bool dump(const char* path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::FILE* file = std::fopen(path, "w");
+        if (!file)
+            return false;
+
+        // ticks per microsecond, measured over the whole run
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start_time_;
+        double ticks_per_us = elapsed.count() > 0 ? static_cast<double>(trace_clock() - start_ticks_) / elapsed.count()
+                                                  : 1;
+
+        std::map<const char*, std::string> names;
+        auto name_of = [&](const char* name) -> const std::string&
+        {
+            auto it = names.find(name);
+            if (it == names.end())
+                it = names.emplace(name, escape(brief_type_name(name))).first;
+            return it->second;
+        };
+
+        const char* separator = "";
+        std::fprintf(file, "{\"traceEvents\":[");
+        for (std::size_t tid = 0; tid < rings_.size(); ++tid)
+        {
+            std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,"
+                               "\"args\":{\"name\":\"thread %zu\"}}", separator, tid, tid);
+            separator = ",";
+
+            rings_[tid]->for_each([&](const trace_ring::event& e)
+            {
+                double ts = static_cast<double>(e.ticks - start_ticks_) / ticks_per_us;
+                auto slice = [&](char phase)
+                {
+                    std::fprintf(file, ",\n{\"name\":\"coroutine\",\"cat\":\"coroutine\",\"ph\":\"%c\",\"ts\":%.3f,"
+                                       "\"pid\":1,\"tid\":%zu,\"args\":{\"frame\":\"%p\"}}",
+                                 phase, ts, tid, e.frame);
+                };
+                auto span = [&](char phase)
+                {
+                    std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"suspended\",\"ph\":\"%c\",\"id\":\"%p\","
+                                       "\"ts\":%.3f,\"pid\":1,\"tid\":%zu}",
+                                 name_of(e.name).c_str(), phase, e.frame, ts, tid);
+                };
+
+                switch (e.kind)
+                {
+                case trace_event::start: slice('B'); break;
+                case trace_event::suspend: slice('E'); span('b'); break;
+                case trace_event::resume: span('e'); slice('B'); break;
+                case trace_event::finish: slice('E'); break;
+                }
+            });
+        }
+        std::fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+        return std::fclose(file) == 0;
+    }
+};
+
+inline void trace(trace_event kind, const void* frame, const char* name) noexcept
+{
+    // the registry is created first: destroyed (and dumped) after the rings stopped being written
+    static thread_local trace_ring& ring = trace_registry::get().add_thread();
+    ring.record(kind, frame, name);
+}
+
+#else
+
+constexpr bool trace_enabled = false;
+
+inline void trace(trace_event, const void*, const char*) noexcept {}
+
+#endif
+
+// start and finish of the coroutine of a promise, to call from initial/final_suspend
+template <typename Promise>
+void trace_coroutine(trace_event kind, Promise& promise) noexcept
+{
+    if constexpr (trace_enabled)
+        trace(kind, std::coroutine_handle<Promise>::from_promise(promise).address(), "coroutine");
+    else
+        (void)promise;
+}
+
+// Suspension of a coroutine in an awaiter: records the suspension, then the resumption in await_resume
+// (trace events and USDT probes, see probes.h). Empty when both are compiled out.
+template <typename Awaiter>
+class trace_suspension
+{
+#if defined(GOR_TRACE) || defined(GOR_HAS_PROBES)
+    const void* frame_ = nullptr;
+
+public:
+    // before the awaiter suspends: the coroutine may be resumed elsewhere before its await_suspend returns
+    void suspend(std::coroutine_handle<> coro) noexcept
+    {
+        frame_ = coro.address();
+        GOR_PROBE2(suspend, frame_, typeid(Awaiter).name());
+        trace(trace_event::suspend, frame_, typeid(Awaiter).name());
+    }
+
+    void resume() noexcept
+    {
+        if (frame_)
+        {
+            GOR_PROBE2(resume, frame_, typeid(Awaiter).name());
+            trace(trace_event::resume, frame_, typeid(Awaiter).name());
+        }
+    }
+#else
+public:
+    void suspend(std::coroutine_handle<>) noexcept {}
+    void resume() noexcept {}
+#endif
+};
+
+// Traces the awaiter of an initial_suspend (not seen by await_transform)
+template <typename Awaiter>
+class traced_awaiter
+{
+    Awaiter awaiter_;
+    [[no_unique_address]] trace_suspension<Awaiter> trace_;
+
+public:
+    explicit traced_awaiter(Awaiter awaiter)
+        : awaiter_(std::move(awaiter)) {}
+
+    bool await_ready() { return awaiter_.await_ready(); }
+
+    template <typename Promise>
+    decltype(auto) await_suspend(std::coroutine_handle<Promise> coro)
+    {
+        trace_.suspend(coro);
+        return awaiter_.await_suspend(coro);
+    }
+
+    decltype(auto) await_resume()
+    {
+        trace_.resume();
+        return awaiter_.await_resume();
+    }
+};
+
+#endif // TRACE_H
@@ -0,0 +1,39 @@
+#ifndef TYPE_NAME_H
+#define TYPE_NAME_H
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+// Readable name of a type for the reports: typeid(T).name() demangled, without the template and function
+// arguments (async_read_some<...>(...)::Awaiter becomes async_read_some::Awaiter)
+inline std::string brief_type_name(const char* name)
+{
+    std::string full = name;
+#if defined(__GNUC__)
+    int status = 0;
+    std::unique_ptr<char, decltype(&std::free)> demangled(
+        abi::__cxa_demangle(name, nullptr, nullptr, &status), &std::free);
+    if (status == 0 && demangled)
+        full = demangled.get();
+#endif
+
+    std::string brief;
+    int depth = 0;
+    for (char c : full)
+    {
+        if (c == '<' || c == '(')
+            ++depth;
+        else if (c == '>' || c == ')')
+            --depth;
+        else if (depth == 0)
+            brief += c;
+    }
+    return brief;
+}
+
+#endif // TYPE_NAME_H
@@ -0,0 +1,197 @@
+//
+// offload_server.cpp
+// ~~~~~~~~~~~~~~~~~~
+//
+// Echo server with a CPU cost per block. The sessions hop into a compute pool to process the
+// blocks (co_await resume_on(pool)) and back into the io_service to write them (co_await resume_on(ios)).
+// A probe timer measures the io thread latency.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+#include <asio.hpp>
+#include <asio/system_timer.hpp>
+
+#include <await_adapters.h>
+#include <future_adapter.h>
+#include <threadpool.h>
+
+// keeps the processing result alive
+std::atomic<std::uint64_t> digest{0};
+
+// CPU heavy processing: hashes the block until cost is spent
+std::uint64_t process(const char* data, size_t n, std::chrono::microseconds cost)
+{
+    auto deadline = std::chrono::steady_clock::now() + cost;
+    std::uint64_t hash = 14695981039346656037ull;
+
+    do
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+    while (std::chrono::steady_clock::now() < deadline);
+
+    return hash;
+}
+
+// Without pool the blocks are processed on the io thread
+std::future<void>
+session(asio::io_service& ios,
+        threadpool::pool* pool,
+        asio::ip::tcp::socket socket,
+        const size_t block_size,
+        const std::chrono::microseconds cost)
+{
+    auto data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        // Initialization
+        socket.set_option(asio::ip::tcp::no_delay(true));
+
+        // loop endlessly
+        for (;;)
+        {
+            // Receive data from the client
+            auto n = co_await async_read_some(socket, asio::buffer(data.get(), block_size));
+
+            if (pool)
+            {
+                co_await resume_on(*pool);
+                digest += process(data.get(), n, cost);
+                co_await resume_on(ios);
+            }
+            else
+                digest += process(data.get(), n, cost);
+
+            // Send data back to the client
+            co_await async_write(socket, asio::buffer(data.get(), n));
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (e.code() != asio::error::eof)
+            std::cerr << "System error: " << e.what() << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    // Close the socket
+    socket.close();
+}
+
+std::future<void>
+server(asio::io_service& ios,
+       threadpool::pool* pool,
+       asio::ip::tcp::endpoint endpoint,
+       const size_t block_size,
+       const std::chrono::microseconds cost)
+{
+    asio::ip::tcp::acceptor acceptor(ios);
+
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(1));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+
+    for (;;)
+    {
+        asio::ip::tcp::socket socket(ios);
+        co_await async_accept(acceptor, socket);
+        session(ios, pool, std::move(socket), block_size, cost);
+    }
+}
+
+// io thread responsiveness: how late a periodic timer fires
+struct latency
+{
+    size_t samples = 0;
+    std::chrono::microseconds total{0};
+    std::chrono::microseconds max{0};
+};
+
+std::future<void>
+probe(asio::io_service& ios, std::chrono::milliseconds period, latency& stats)
+{
+    asio::system_timer timer(ios);
+
+    for (;;)
+    {
+        auto expected = std::chrono::system_clock::now() + period;
+        co_await async_wait(timer, period);
+
+        auto late = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now() - expected);
+        late = std::max(late, std::chrono::microseconds{0});
+
+        ++stats.samples;
+        stats.total += late;
+        stats.max = std::max(stats.max, late);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 6)
+        {
+            std::cerr << "Usage: offload_server <address> <port> <threads> <blocksize> <microseconds>" << std::endl;
+            std::cerr << "  <threads> compute pool threads, 0 processes the blocks on the io thread" << std::endl;
+            std::cerr << "  <microseconds> CPU cost per block" << std::endl;
+            return 1;
+        }
+
+        using namespace std; // For atoi.
+        asio::ip::address address = asio::ip::address::from_string(argv[1]);
+        short port = static_cast<short>(atoi(argv[2]));
+        int thread_count = atoi(argv[3]);
+        size_t block_size = atoi(argv[4]);
+        std::chrono::microseconds cost(atoi(argv[5]));
+
+        asio::io_service ios;
+
+        std::unique_ptr<threadpool::pool> pool;
+        if (thread_count > 0)
+            pool = std::make_unique<threadpool::pool>(thread_count);
+
+        server(ios, pool.get(), asio::ip::tcp::endpoint(address, port), block_size, cost);
+
+        latency stats;
+        probe(ios, std::chrono::milliseconds(1), stats);
+
+        // Handle user signals for loop interruption
+        asio::signal_set signals(ios, SIGINT, SIGTERM);
+        signals.async_wait([&ios](const std::error_code& error, int signal_number)
+            {
+                if (error || signal_number == SIGINT || signal_number == SIGTERM)
+                    ios.stop();
+            });
+
+        // a single io thread
+        ios.run();
+
+        std::cout << "io thread latency: "
+                  << (stats.samples ? stats.total.count() / stats.samples : 0) << " us average, "
+                  << stats.max.count() << " us max ("
+                  << stats.samples << " samples)" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+//
+// pool_bench.cpp
+// ~~~~~~~~~~~~~~
+//
+// threadpool.h task throughput and steal rate
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <latch>
+
+#include <threadpool.h>
+
+// Ping-pong through the pool queues: every co_await is a task
+std::future<void> hop(threadpool::pool& pool, size_t hops, std::latch& done)
+{
+    while (hops-- > 0)
+        co_await pool.schedule();
+
+    done.count_down();
+}
+
+// A single coroutine spawns all the work into its own deque: the other workers must steal it
+std::future<void> leaf(threadpool::pool&, size_t work, std::latch& done)
+{
+    volatile size_t sink = 0;
+    for (size_t i = 0; i < work; ++i)
+        sink = sink + i;
+
+    done.count_down();
+    co_return;
+}
+
+std::future<void> fan_out(threadpool::pool& pool, size_t tasks, size_t work, std::latch& done)
+{
+    for (size_t i = 0; i < tasks; ++i)
+        leaf(pool, work, done);
+
+    co_return;
+}
+
+template <typename Run>
+void measure(const char* name, unsigned threads, size_t tasks, Run&& run)
+{
+    threadpool::pool pool(threads);
+
+    auto start = std::chrono::steady_clock::now();
+    run(pool);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto executed = pool.executed();
+    auto steals = pool.steals();
+
+    std::cout << name << ": " << tasks / elapsed.count() / 1e6 << " M tasks/s, "
+              << executed << " resumptions, "
+              << steals << " steals (" << 100.0 * steals / executed << "%)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: pool_bench <threads> <coroutines> <tasks>" << std::endl;
+        return 1;
+    }
+
+    unsigned thread_count = atoi(argv[1]);
+    size_t coroutines = atoi(argv[2]);
+    size_t tasks = atoi(argv[3]);
+
+    measure("hop", thread_count, tasks, [&](threadpool::pool& pool)
+    {
+        std::latch done(coroutines);
+        for (size_t i = 0; i < coroutines; ++i)
+            hop(pool, tasks / coroutines, done);
+        done.wait();
+    });
+
+    measure("fan out", thread_count, tasks, [&](threadpool::pool& pool)
+    {
+        std::latch done(tasks);
+        fan_out(pool, tasks, 1000, done);
+        done.wait();
+    });
+
+    return 0;
+}
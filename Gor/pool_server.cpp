@@ -0,0 +1,122 @@
+//
+// pool_server.cpp
+// ~~~~~~~~~~~~~~~
+//
+// Port of winrt/winrt_server.cpp session logic on top of threadpool.h:
+// one thread runs the io_service while the session coroutines run on a work-stealing pool.
+//
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <memory>
+
+#include <asio.hpp>
+
+#include <await_adapters.h>
+#include <future_adapter.h>
+#include <threadpool.h>
+
+// The threadpool::pool& first argument selects the pool promise:
+// the body starts on the pool and every co_await resumes on the pool.
+std::future<void>
+session(threadpool::pool&,
+        asio::ip::tcp::socket socket,
+        const size_t block_size)
+{
+    auto data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        // Initialization
+        socket.set_option(asio::ip::tcp::no_delay(true));
+
+        // loop endlessly
+        for (;;)
+        {
+            // Receive data from the client
+            auto n = co_await async_read_some(socket, asio::buffer(data.get(), block_size));
+
+            // Send data back to the client
+            co_await async_write(socket, asio::buffer(data.get(), n));
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (e.code() != asio::error::eof)
+            std::cerr << "System error: " << e.what() << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    // Close the socket
+    socket.close();
+}
+
+// the acceptor runs on the io_service thread
+std::future<void>
+server(asio::io_service& ios,
+       threadpool::pool& pool,
+       asio::ip::tcp::endpoint endpoint,
+       const size_t block_size)
+{
+    asio::ip::tcp::acceptor acceptor(ios);
+
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(1));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+
+    for (;;)
+    {
+        asio::ip::tcp::socket socket(ios);
+        co_await async_accept(acceptor, socket);
+        session(pool, std::move(socket), block_size);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 5)
+        {
+            std::cerr << "Usage: pool_server <address> <port> <threads> <blocksize>" << std::endl;
+            return 1;
+        }
+
+        using namespace std; // For atoi.
+        asio::ip::address address = asio::ip::address::from_string(argv[1]);
+        short port = static_cast<short>(atoi(argv[2]));
+        int thread_count = atoi(argv[3]);
+        size_t block_size = atoi(argv[4]);
+
+        asio::io_service ios;
+
+        // Create threadpool
+        threadpool::pool pool(thread_count);
+
+        server(ios, pool, asio::ip::tcp::endpoint(address, port), block_size);
+
+        // Handle user signals for loop interruption
+        asio::signal_set signals(ios, SIGINT, SIGTERM);
+        signals.async_wait([&ios](const std::error_code& error, int signal_number)
+            {
+                if (error || signal_number == SIGINT || signal_number == SIGTERM)
+                    ios.stop();
+            });
+
+        // the io_service thread only runs the completion handlers
+        ios.run();
+
+        std::cout << pool.executed() << " resumptions, " << pool.steals() << " steals" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
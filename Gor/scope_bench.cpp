@@ -0,0 +1,113 @@
+//
+// scope_bench.cpp
+// ~~~~~~~~~~~~~~~
+//
+// async_scope shutdown time: cancels and joins the given number of live echo sessions.
+// The sessions are connected to in-process peers through local socket pairs (POSIX only).
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <asio.hpp>
+
+#include <async_scope.h>
+#include <await_adapters.h>
+#include <descriptor_limit.h>
+#include <future_adapter.h>
+
+using local_socket = asio::local::stream_protocol::socket;
+
+// live session frames
+std::atomic<size_t> live{0};
+
+struct frame_counter
+{
+    frame_counter() { ++live; }
+    ~frame_counter() { --live; }
+};
+
+std::future<void>
+session(async_scope& scope, local_socket socket, const size_t block_size)
+{
+    frame_counter counter;
+
+    auto data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        for (;;)
+        {
+            auto n = co_await async_read_some(socket, asio::buffer(data.get(), block_size));
+            co_await async_write(socket, asio::buffer(data.get(), n));
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (!scope.stop_requested())
+            std::cerr << "System error: " << e.what() << std::endl;
+    }
+}
+
+std::future<void>
+shutdown(asio::io_service& ios, async_scope& scope, size_t sessions)
+{
+    co_await post(ios);
+
+    auto start = std::chrono::steady_clock::now();
+
+    scope.request_stop();
+    co_await scope.join();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << sessions << " sessions cancelled and joined in " << elapsed.count() << " ms, "
+              << live << " frames left" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 2)
+        {
+            std::cerr << "Usage: scope_bench <sessions>" << std::endl;
+            return 1;
+        }
+
+        size_t sessions = raise_descriptor_limit(atoi(argv[1]));
+
+        asio::io_service ios;
+        async_scope scope;
+        std::vector<local_socket> peers;
+        peers.reserve(sessions);
+
+        for (size_t i = 0; i < sessions; ++i)
+        {
+            local_socket socket(ios);
+            peers.emplace_back(ios);
+            asio::local::connect_pair(socket, peers.back());
+
+            session(scope, std::move(socket), 1024);
+        }
+
+        std::cout << live << " live sessions" << std::endl;
+
+        shutdown(ios, scope, sessions);
+
+        auto start = std::chrono::steady_clock::now();
+        ios.run();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "io_service drained in " << elapsed.count() << " ms" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+//
+// scope_server.cpp
+// ~~~~~~~~~~~~~~~~
+//
+// server.cpp with the acceptor and the sessions owned by an async_scope.
+// On SIGINT the scope cancels all of them and joins: every coroutine frame and socket is released
+// and io_service::run() returns on its own.
+//
+
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <memory>
+
+#include <asio.hpp>
+
+#include <async_scope.h>
+#include <await_adapters.h>
+#include <future_adapter.h>
+
+// owned by the scope (first argument)
+std::future<void>
+session(async_scope& scope,
+        asio::ip::tcp::socket socket,
+        const size_t block_size)
+{
+    auto data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        // Initialization
+        socket.set_option(asio::ip::tcp::no_delay(true));
+
+        // loop until cancelled
+        for (;;)
+        {
+            // Receive data from the client
+            auto n = co_await async_read_some(socket, asio::buffer(data.get(), block_size));
+
+            // Send data back to the client
+            co_await async_write(socket, asio::buffer(data.get(), n));
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (!scope.stop_requested() && e.code() != asio::error::eof)
+            std::cerr << "System error: " << e.what() << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+}
+
+// the acceptor coroutine is still in the scope
+bool accepting = false;
+
+std::future<void>
+server(async_scope& scope,
+       asio::io_service& ios,
+       asio::ip::tcp::endpoint endpoint,
+       const size_t block_size)
+{
+    asio::ip::tcp::acceptor acceptor(ios);
+    accepting = true;
+
+    try
+    {
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(1));
+        acceptor.bind(endpoint);
+        acceptor.listen();
+
+        while (!scope.stop_requested())
+        {
+            asio::ip::tcp::socket socket(ios);
+            co_await async_accept(acceptor, socket);
+            session(scope, std::move(socket), block_size);
+        }
+    }
+    catch (std::exception& e)
+    {
+        if (!scope.stop_requested())
+            std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    accepting = false;
+}
+
+// cancel and join all the scope coroutines
+std::future<void>
+shutdown(asio::io_service&, async_scope& scope)
+{
+    auto sessions = scope.size() - (accepting ? 1 : 0);
+    auto start = std::chrono::steady_clock::now();
+
+    scope.request_stop();
+    co_await scope.join();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << sessions << " sessions cancelled and joined in " << elapsed.count() << " ms" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 4)
+        {
+            std::cerr << "Usage: scope_server <address> <port> <blocksize>" << std::endl;
+            return 1;
+        }
+
+        using namespace std; // For atoi.
+        asio::ip::address address = asio::ip::address::from_string(argv[1]);
+        short port = static_cast<short>(atoi(argv[2]));
+        size_t block_size = atoi(argv[3]);
+
+        asio::io_service ios;
+        async_scope scope;
+
+        server(scope, ios, asio::ip::tcp::endpoint(address, port), block_size);
+
+        // Handle user signals for cancellation
+        asio::signal_set signals(ios, SIGINT, SIGTERM);
+        signals.async_wait([&ios, &scope](const std::error_code& error, int)
+            {
+                if (!error)
+                    shutdown(ios, scope);
+            });
+
+        // returns once the scope is drained: no pending work is left
+        ios.run();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
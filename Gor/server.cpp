@@ -9,6 +9,7 @@
 //
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <list>
@@ -17,8 +18,20 @@
 
 #include <asio.hpp>
 
+#include <alloc_stats.h>
 #include <await_adapters.h>
+#include <await_stats.h>
+#include <busy_poll.h>
 #include <future_adapter.h>
+#include <metrics_endpoint.h>
+#include <probes.h>
+
+// live metrics, see metrics_endpoint.h
+metrics::gauge sessions_active("gor_sessions_active", "Sessions in progress");
+metrics::counter sessions_total("gor_sessions_total", "Sessions accepted");
+metrics::counter bytes_read("gor_read_bytes_total", "Bytes received");
+metrics::counter bytes_written("gor_written_bytes_total", "Bytes sent");
+metrics::histogram read_size("gor_read_size_bytes", "Bytes per read");
 
 std::future<void>
 session(asio::ip::tcp::socket socket,
@@ -26,6 +39,10 @@ session(asio::ip::tcp::socket socket,
 {
     auto read_data = std::make_unique<char[]>(block_size);
     auto write_data = std::make_unique<char[]>(block_size);
+    auto fd = socket.native_handle();
+    GOR_PROBE1(session_start, fd);
+    sessions_total.add();
+    sessions_active.add(1);
 
     try
     {
@@ -35,16 +52,20 @@ session(asio::ip::tcp::socket socket,
         socket.set_option(no_delay, set_option_err);
         if (set_option_err)
             throw std::runtime_error("Failed to set socket option");
+        tune_socket(socket);
 
         // loop endlessly
         for (;;)
         {
             // Receive data from the server
-            co_await async_read_some(socket, asio::buffer(read_data.get(), block_size));
+            auto n = co_await async_read_some(socket, asio::buffer(read_data.get(), block_size));
+            bytes_read.add(n);
+            read_size.record(n);
             // Swap the buffers
             std::swap(read_data, write_data);
             // Send data to the server
             co_await async_write(socket, asio::buffer(write_data.get(), block_size));
+            bytes_written.add(block_size);
         }
     }
     catch (asio::system_error& e)
@@ -59,6 +80,8 @@ session(asio::ip::tcp::socket socket,
 
     // Close the socket
     socket.close();
+    sessions_active.add(-1);
+    GOR_PROBE1(session_end, fd);
 }
 
 std::future<void>
@@ -104,13 +127,15 @@ int main(int argc, char* argv[])
         asio::io_service ios;
 
         server(ios, asio::ip::tcp::endpoint(address, port), block_size);
+        start_metrics_endpoint(ios);
 
         // Threads not currently supported in this test.
+        // io threads (see busy_poll.h for the low latency knobs)
+        auto start = std::chrono::steady_clock::now();
         std::list<std::thread*> threads;
-        while (--thread_count > 0)
+        for (int i = 1; i < thread_count; ++i)
         {
-            std::size_t (asio::io_service::* handler)() = &asio::io_service::run;
-            std::thread* new_thread = new std::thread(std::bind(handler, &ios));
+            std::thread* new_thread = new std::thread([&ios, i] { run_io_thread(ios, i); });
             threads.push_back(new_thread);
         }
 
@@ -122,8 +147,23 @@ int main(int argc, char* argv[])
                     ios.stop();
             });
 
+        // kill -USR1 prints the co_await statistics while running (see await_stats.h)
+        asio::signal_set report(ios);
+        std::function<void(const std::error_code&, int)> on_report = [&](const std::error_code& error, int)
+            {
+                if (error)
+                    return;
+                await_stats::print(std::cout);
+                report.async_wait(on_report);
+            };
+        if (await_stats_enabled)
+        {
+            report.add(SIGUSR1);
+            report.async_wait(on_report);
+        }
+
         // loop until interrupted
-        ios.run();
+        run_io_thread(ios, 0);
 
         while (!threads.empty())
         {
@@ -131,6 +171,12 @@ int main(int argc, char* argv[])
             delete threads.front();
             threads.pop_front();
         }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "cpu " << cpu_seconds() << " s in " << elapsed.count() << " s" << std::endl;
+        report_allocations(std::cout);
+        if (await_stats_enabled)
+            await_stats::print(std::cout);
     }
     catch (std::exception& e)
     {
@@ -0,0 +1,168 @@
+//
+// stop_bench.cpp
+// ~~~~~~~~~~~~~~
+//
+// Time to stop the given number of ping-pong sessions: an atomic_bool flag checked once per round trip
+// (as client.cpp used to) against a stop token propagated into the awaiters (cancellation.h).
+// The peers delay every reply, so the sessions spend their time suspended in async_read_some.
+// The sessions are connected to in-process peers through local socket pairs (POSIX only).
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stop_token>
+#include <vector>
+
+#include <asio.hpp>
+
+#include <await_adapters.h>
+#include <descriptor_limit.h>
+#include <future_adapter.h>
+
+using local_socket = asio::local::stream_protocol::socket;
+
+struct stopwatch
+{
+    size_t running = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::duration<double, std::milli> elapsed{};
+    std::stop_source peers;
+
+    void finished()
+    {
+        if (--running == 0)
+        {
+            elapsed = std::chrono::steady_clock::now() - start;
+            peers.request_stop();
+        }
+    }
+};
+
+// noticed at the next loop iteration: up to one round trip later
+bool stopped(const std::atomic_bool* flag)
+{
+    return flag->load(std::memory_order_relaxed);
+}
+
+// the token also aborts the pending operation
+bool stopped(const std::stop_token& token)
+{
+    return token.stop_requested();
+}
+
+template <typename Stop>
+std::future<void>
+session(local_socket socket, const size_t block_size, Stop stop, stopwatch& watch)
+{
+    auto data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        while (!stopped(stop))
+        {
+            co_await async_write(socket, asio::buffer(data.get(), block_size));
+            co_await async_read_some(socket, asio::buffer(data.get(), block_size));
+        }
+    }
+    catch (std::system_error& e)
+    {
+        if (e.code() != asio::error::operation_aborted)
+            std::cerr << "System error: " << e.what() << std::endl;
+    }
+
+    watch.finished();
+}
+
+// echoes every block after the given delay, until cancelled or the session closes the socket
+std::future<void>
+peer(asio::io_service& ios,
+     local_socket socket,
+     const size_t block_size,
+     std::chrono::milliseconds delay,
+     std::stop_token)
+{
+    asio::steady_timer timer(ios);
+    auto data = std::make_unique<char[]>(block_size);
+
+    try
+    {
+        for (;;)
+        {
+            auto n = co_await async_read_some(socket, asio::buffer(data.get(), block_size));
+            co_await async_wait(timer, delay);
+            co_await async_write(socket, asio::buffer(data.get(), n));
+        }
+    }
+    catch (std::system_error&)
+    {
+    }
+}
+
+template <typename Request>
+std::future<void>
+request_stop(asio::io_service& ios, std::chrono::milliseconds warm_up, stopwatch& watch, Request request)
+{
+    asio::steady_timer timer(ios);
+    co_await async_wait(timer, warm_up);
+
+    watch.start = std::chrono::steady_clock::now();
+    request();
+}
+
+template <typename Stop, typename Request>
+double measure(size_t sessions, std::chrono::milliseconds delay, Stop stop, Request request)
+{
+    const size_t block_size = 64;
+
+    asio::io_service ios;
+    stopwatch watch;
+
+    for (size_t i = 0; i < sessions; ++i)
+    {
+        local_socket socket(ios);
+        local_socket other(ios);
+        asio::local::connect_pair(socket, other);
+
+        peer(ios, std::move(other), block_size, delay, watch.peers.get_token());
+        session(std::move(socket), block_size, stop, watch);
+        ++watch.running;
+    }
+
+    // a few round trips
+    request_stop(ios, 3 * delay + std::chrono::milliseconds(10), watch, request);
+    ios.run();
+
+    return watch.elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 3)
+        {
+            std::cerr << "Usage: stop_bench <sessions> <delay ms>" << std::endl;
+            return 1;
+        }
+
+        size_t sessions = raise_descriptor_limit(atoi(argv[1]));
+        std::chrono::milliseconds delay(atoi(argv[2]));
+
+        std::atomic_bool flag(false);
+        auto flag_ms = measure(sessions, delay, &flag, [&flag] { flag = true; });
+        std::cout << "atomic_bool flag: " << sessions << " sessions stopped in " << flag_ms << " ms" << std::endl;
+
+        std::stop_source source;
+        auto token_ms = measure(sessions, delay, source.get_token(), [&source] { source.request_stop(); });
+        std::cout << "stop token:       " << sessions << " sessions stopped in " << token_ms << " ms" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+//
+// sync_bench.cpp
+// ~~~~~~~~~~~~~~
+//
+// async_sync.h primitives on a threadpool.h pool against std::mutex and std::counting_semaphore
+// guarded critical sections on plain threads.
+//
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdlib>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+#include <async_sync.h>
+#include <threadpool.h>
+
+// critical section: touches shared state
+struct shared_state
+{
+    size_t counter = 0;
+    size_t data[16] = {};
+
+    void update() noexcept
+    {
+        ++counter;
+        for (auto& d : data)
+            d += counter;
+    }
+};
+
+template <typename Run>
+void measure(const char* name, size_t operations, Run&& run)
+{
+    auto start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << name << ": " << elapsed.count() << " s, "
+              << operations / elapsed.count() / 1e6 << " M ops/s" << std::endl;
+}
+
+// plain threads blocking on std synchronization
+template <typename Section>
+void threads_run(unsigned thread_count, size_t iterations, Section section)
+{
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < thread_count; ++i)
+        threads.emplace_back([&]
+        {
+            for (size_t n = 0; n < iterations; ++n)
+                section();
+        });
+
+    for (auto& t : threads)
+        t.join();
+}
+
+std::future<void> mutex_worker(threadpool::pool&, async_mutex& m, shared_state& s, size_t iterations, std::latch& done)
+{
+    for (size_t n = 0; n < iterations; ++n)
+    {
+        auto lock = co_await m.scoped_lock_async();
+        s.update();
+    }
+
+    done.count_down();
+}
+
+std::future<void> semaphore_worker(threadpool::pool&, async_semaphore& sem, std::atomic<size_t>& counter,
+                                   size_t iterations, std::latch& done)
+{
+    for (size_t n = 0; n < iterations; ++n)
+    {
+        co_await sem.acquire();
+        counter.fetch_add(1, std::memory_order_relaxed);
+        sem.release();
+    }
+
+    done.count_down();
+}
+
+// counts the waiter once it is queued on the event: set() after started.wait() takes the wake-all path for all of them
+struct registered_awaiter
+{
+    async_manual_reset_event::awaiter awaiter;
+    std::latch& started;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> coro) noexcept
+    {
+        auto& registered = started; // the awaiter is gone once the coroutine is resumed
+        bool suspended = awaiter.await_suspend(coro);
+        registered.count_down();
+        return suspended;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+std::future<void> event_waiter(threadpool::pool&, async_manual_reset_event& event, std::latch& started, std::latch& done)
+{
+    co_await registered_awaiter{event.operator co_await(), started};
+    done.count_down();
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: sync_bench <threads> <coroutines> <iterations>" << std::endl;
+        return 1;
+    }
+
+    unsigned thread_count = atoi(argv[1]);
+    size_t coroutines = atoi(argv[2]);
+    size_t iterations = atoi(argv[3]);
+
+    // the same amount of critical sections split among the threads or the coroutines
+    size_t operations = iterations * thread_count;
+    size_t per_coroutine = operations / coroutines;
+    operations = per_coroutine * coroutines;
+    iterations = operations / thread_count;
+    std::ptrdiff_t permits = std::max(thread_count / 2, 1u);
+
+    std::cout << thread_count << " threads, " << coroutines << " coroutines, "
+              << operations << " critical sections" << std::endl;
+
+    // mutex
+    {
+        shared_state s;
+        std::mutex m;
+        measure("std::mutex", operations, [&]
+        {
+            threads_run(thread_count, iterations, [&]
+            {
+                std::lock_guard lock(m);
+                s.update();
+            });
+        });
+    }
+
+    {
+        shared_state s;
+        async_mutex m;
+        threadpool::pool pool(thread_count);
+        std::latch done(coroutines);
+
+        measure("async_mutex", operations, [&]
+        {
+            for (size_t i = 0; i < coroutines; ++i)
+                mutex_worker(pool, m, s, per_coroutine, done);
+            done.wait();
+        });
+
+        if (s.counter != operations)
+            std::cerr << "async_mutex: lost updates" << std::endl;
+    }
+
+    // semaphore
+    {
+        std::atomic<size_t> counter{0};
+        std::counting_semaphore<> sem(permits);
+        measure("std::counting_semaphore", operations, [&]
+        {
+            threads_run(thread_count, iterations, [&]
+            {
+                sem.acquire();
+                counter.fetch_add(1, std::memory_order_relaxed);
+                sem.release();
+            });
+        });
+    }
+
+    {
+        std::atomic<size_t> counter{0};
+        async_semaphore sem(permits);
+        threadpool::pool pool(thread_count);
+        std::latch done(coroutines);
+
+        measure("async_semaphore", operations, [&]
+        {
+            for (size_t i = 0; i < coroutines; ++i)
+                semaphore_worker(pool, sem, counter, per_coroutine, done);
+            done.wait();
+        });
+
+        if (counter != operations)
+            std::cerr << "async_semaphore: lost updates" << std::endl;
+    }
+
+    // event: wake all the coroutines at once
+    {
+        async_manual_reset_event event;
+        threadpool::pool pool(thread_count);
+        std::latch started(coroutines);
+        std::latch done(coroutines);
+
+        for (size_t i = 0; i < coroutines; ++i)
+            event_waiter(pool, event, started, done);
+        started.wait();
+
+        measure("async_manual_reset_event", coroutines, [&]
+        {
+            event.set();
+            done.wait();
+        });
+    }
+
+    return 0;
+}
@@ -1,4 +1,4 @@
-// > cl /EHsc /std:c++20 future.cpp
+// > cl /EHsc /std:c++20 /I ..\include future.cpp
 
 #include <chrono>
 #include <coroutine>
@@ -8,6 +8,8 @@
 #include <thread>
 #include <type_traits>
 
+#include <future_waiter.h>
+
 // A program-defined type on which the coroutine_traits specializations below depend
 struct as_coroutine {};
 
@@ -71,34 +73,14 @@ struct std::coroutine_traits<std::future<void>, as_coroutine, Args...>
     };
 };
 
-// Allow co_await'ing std::future<T> and std::future<void>
-// by naively spawning a new thread for each co_await.
+// Allow co_await'ing std::future<T> and std::future<void>.
+// Instead of spawning a new thread for each co_await, the pending futures are
+// multiplexed onto the shared pool of waiter threads (see future_waiter.h).
 template<typename T>
 auto operator co_await(std::future<T> future) noexcept
     requires(!std::is_reference_v<T>)
 {
-    struct awaiter : std::future<T>
-    {
-        bool await_ready() const noexcept
-        {
-            using namespace std::chrono_literals;
-            return this->wait_for(0s) != std::future_status::timeout;
-        }
-
-        void await_suspend(std::coroutine_handle<> cont) const
-        {
-            std::thread([this, cont]
-            {
-                this->wait();
-                std::cout << "resuming from " << std::this_thread::get_id() << std::endl;
-                cont();
-            }).detach();
-        }
-
-        T await_resume() { return this->get(); }
-    };
-
-    return awaiter { std::move(future) };
+    return future_waiter::shared().await(std::move(future));
 }
 
 // Utilize the infrastructure we have established.
@@ -107,6 +89,7 @@ std::future<int> compute(as_coroutine)
     std::cout << "starting on " << std::this_thread::get_id() << std::endl;
     int a = co_await std::async([] { return 6; });
     int b = co_await std::async([] { return 7; });
+    std::cout << "resuming from " << std::this_thread::get_id() << std::endl;
     co_return a * b;
 }
 
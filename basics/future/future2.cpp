@@ -0,0 +1,108 @@
+// > cl /EHsc /std:c++20 /O2 /I ..\include .\future2.cpp
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include <future_waiter.h>
+
+using namespace std;
+
+// fire and forget coroutine
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() noexcept { return {}; }
+        suspend_never initial_suspend() const noexcept { return {}; }
+        suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { terminate(); }
+    };
+};
+
+// future.cpp original awaiter: a new thread for each co_await
+template <typename T>
+struct thread_per_await : future<T>
+{
+    bool await_ready() const noexcept
+    {
+        return this->wait_for(0s) != future_status::timeout;
+    }
+
+    void await_suspend(coroutine_handle<> cont) const
+    {
+        thread([this, cont]
+        {
+            this->wait();
+            cont();
+        }).detach();
+    }
+
+    T await_resume() { return this->get(); }
+};
+
+template <typename Awaitable>
+task consume(Awaitable awaitable, atomic<long long>& sum, latch& done)
+{
+    sum += co_await awaitable;
+    done.count_down();
+}
+
+// Awaits count futures, batch of them pending at the same time
+template <typename MakeAwaitable>
+void measure(const char* name, size_t count, size_t batch, MakeAwaitable&& make_awaitable)
+{
+    atomic<long long> sum = 0;
+
+    auto start = chrono::steady_clock::now();
+
+    for (size_t first = 0; first < count; first += batch)
+    {
+        size_t n = min(batch, count - first);
+
+        vector<promise<int>> promises(n);
+        latch done(static_cast<ptrdiff_t>(n));
+
+        // all the coroutines suspend awaiting
+        for (auto& p : promises)
+            consume(make_awaitable(p.get_future()), sum, done);
+
+        for (size_t i = 0; i < n; ++i)
+            promises[i].set_value(static_cast<int>(first + i));
+
+        done.wait();
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    long long expected = static_cast<long long>(count) * (count - 1) / 2;
+    cout << name << " (" << batch << " pending): " << elapsed.count() << " s "
+         << count / elapsed.count() << " awaits/s "
+         << (sum == expected ? "ok" : "WRONG SUM") << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t count = argc > 1 ? atoi(argv[1]) : 100'000;
+    size_t batch = argc > 2 ? atoi(argv[2]) : 1'000;
+    unsigned threads = argc > 3 ? atoi(argv[3]) : 2;
+
+    future_waiter waiter(threads);
+
+    // the thread per await batch is bounded: all the futures pending at once would mean count threads
+    measure("thread per await", count, batch, [](future<int> f) { return thread_per_await<int>{std::move(f)}; });
+    measure("future_waiter", count, batch, [&](future<int> f) { return waiter.await(std::move(f)); });
+    measure("future_waiter", count, count, [&](future<int> f) { return waiter.await(std::move(f)); });
+
+    cout << "future_waiter threads: " << waiter.size() << endl;
+
+    return 0;
+}
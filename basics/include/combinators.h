@@ -0,0 +1,123 @@
+#ifndef COMBINATORS_H
+#define COMBINATORS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <generator.h>
+
+// Generators combining several inputs. All of them take the input generators by value,
+// thus their coroutine frames own the inputs.
+
+// k-way merge of sorted generators.
+// A binary heap keeps the input whose current value is the minimum on top. Only that input is
+// resumed after its value is yielded, then it is sifted back into the heap: O(log k) per element.
+template <typename T, typename Compare = std::less<>>
+generator<T> merge(std::vector<generator<T>> sources, Compare comp = {})
+{
+    using iterator = typename generator<T>::iterator;
+
+    std::vector<iterator> heads;
+    heads.reserve(sources.size());
+
+    std::vector<std::size_t> heap;
+    heap.reserve(sources.size());
+
+    for (auto& s : sources)
+    {
+        heads.push_back(s.begin());
+        if (heads.back() != s.end())
+            heap.push_back(heads.size() - 1);
+    }
+
+    // std heap algorithms keep the greatest on top, reverse the comparison
+    auto greater = [&](std::size_t a, std::size_t b) { return comp(*heads[b], *heads[a]); };
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        auto& it = heads[heap.back()];
+
+        co_yield *it;
+
+        // resume only the input that provided the minimum
+        if (++it != std::default_sentinel)
+            std::push_heap(heap.begin(), heap.end(), greater);
+        else
+            heap.pop_back();
+    }
+}
+
+template <typename T, typename... Rest>
+generator<T> merge(generator<T> first, Rest... rest)
+{
+    std::vector<generator<T>> sources;
+    sources.reserve(1 + sizeof...(rest));
+    sources.push_back(std::move(first));
+    (sources.push_back(std::move(rest)), ...);
+
+    return merge(std::move(sources));
+}
+
+// Yields tuples with a value of each input until any of them is exhausted
+template <typename... Ts>
+generator<std::tuple<Ts...>> zip(generator<Ts>... sources)
+{
+    auto heads = std::tuple{sources.begin()...};
+
+    auto done = [&]
+    {
+        return std::apply([](auto&... it) { return (... || (it == std::default_sentinel)); }, heads);
+    };
+
+    while (!done())
+    {
+        co_yield std::apply([](auto&... it) { return std::tuple<Ts...>{*it...}; }, heads);
+        std::apply([](auto&... it) { (++it, ...); }, heads);
+    }
+}
+
+// Yields a value of each input in turn, skipping the exhausted ones
+template <typename T>
+generator<T> interleave(std::vector<generator<T>> sources)
+{
+    using iterator = typename generator<T>::iterator;
+
+    std::vector<iterator> heads;
+    heads.reserve(sources.size());
+
+    for (auto& s : sources)
+        if (auto it = s.begin(); it != s.end())
+            heads.push_back(it);
+
+    while (!heads.empty())
+    {
+        for (std::size_t i = 0; i < heads.size();)
+        {
+            co_yield *heads[i];
+
+            if (++heads[i] == std::default_sentinel)
+                heads.erase(heads.begin() + i);
+            else
+                ++i;
+        }
+    }
+}
+
+template <typename T, typename... Rest>
+generator<T> interleave(generator<T> first, Rest... rest)
+{
+    std::vector<generator<T>> sources;
+    sources.reserve(1 + sizeof...(rest));
+    sources.push_back(std::move(first));
+    (sources.push_back(std::move(rest)), ...);
+
+    return interleave(std::move(sources));
+}
+
+#endif // COMBINATORS_H
@@ -0,0 +1,125 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+// Promise mixin that lets the coroutine caller choose where the coroutine frame is allocated.
+// The coroutine frame is allocated using the promise type operator new. The compiler first tries
+// an overload taking the coroutine arguments, thus a coroutine declared as:
+//
+//   generator<int> seq(std::allocator_arg_t, Alloc const& alloc, ...);
+//   generator<int> object::member(std::allocator_arg_t, Alloc const& alloc, ...);
+//
+// gets its frame from `alloc`. Otherwise the frame comes from the global heap.
+//
+// The promise operator delete only gets the frame pointer and size, thus a copy of the allocator and
+// the function that knows how to release the frame are stored at the end of it:
+//
+//   [coroutine frame][deallocate function pointer][allocator copy]
+//
+struct frame_allocator_promise
+{
+private:
+
+    using deallocate_fn = void (*)(void* frame, std::size_t size) noexcept;
+
+    // allocation unit that keeps the frame aligned as if allocated with ::operator new
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) block
+    {
+        std::byte data[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+    };
+
+    template <typename Alloc>
+    using block_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<block>;
+
+    template <typename Alloc>
+    using block_traits = std::allocator_traits<block_allocator<Alloc>>;
+
+    static constexpr std::size_t align_up(std::size_t n, std::size_t alignment) noexcept
+    {
+        return (n + alignment - 1) & ~(alignment - 1);
+    }
+
+    static constexpr std::size_t function_offset(std::size_t size) noexcept
+    {
+        return align_up(size, alignof(deallocate_fn));
+    }
+
+    template <typename Alloc>
+    static constexpr std::size_t allocator_offset(std::size_t size) noexcept
+    {
+        return align_up(function_offset(size) + sizeof(deallocate_fn), alignof(block_allocator<Alloc>));
+    }
+
+    template <typename Alloc>
+    static constexpr std::size_t block_count(std::size_t size) noexcept
+    {
+        return (allocator_offset<Alloc>(size) + sizeof(block_allocator<Alloc>) + sizeof(block) - 1) / sizeof(block);
+    }
+
+    template <typename Alloc>
+    static void* allocate(std::size_t size, Alloc const& alloc)
+    {
+        static_assert(alignof(block_allocator<Alloc>) <= alignof(block), "over-aligned allocators are not supported");
+
+        block_allocator<Alloc> a(alloc);
+        auto frame = reinterpret_cast<std::byte*>(block_traits<Alloc>::allocate(a, block_count<Alloc>(size)));
+
+        // keep allocator and deallocation function after the frame
+        ::new (frame + allocator_offset<Alloc>(size)) block_allocator<Alloc>(std::move(a));
+        ::new (frame + function_offset(size)) deallocate_fn(&deallocate<Alloc>);
+
+        return frame;
+    }
+
+    template <typename Alloc>
+    static void deallocate(void* frame, std::size_t size) noexcept
+    {
+        auto stored = std::launder(reinterpret_cast<block_allocator<Alloc>*>(
+                    static_cast<std::byte*>(frame) + allocator_offset<Alloc>(size)));
+
+        // the allocator copy lives in the memory about to be released
+        block_allocator<Alloc> a(std::move(*stored));
+        stored->~block_allocator<Alloc>();
+
+        block_traits<Alloc>::deallocate(a, static_cast<block*>(frame), block_count<Alloc>(size));
+    }
+
+public:
+
+    // coroutines without allocator use the global heap
+    static void* operator new(std::size_t size)
+    {
+        return allocate(size, std::allocator<block>{});
+    }
+
+    // free coroutines: generator<T> f(std::allocator_arg_t, Alloc const&, Args...)
+    template <typename Alloc, typename... Args>
+    static void* operator new(std::size_t size, std::allocator_arg_t, Alloc const& alloc, Args const&...)
+    {
+        return allocate(size, alloc);
+    }
+
+    // member coroutines: generator<T> Class::f(std::allocator_arg_t, Alloc const&, Args...)
+    template <typename This, typename Alloc, typename... Args>
+    static void* operator new(std::size_t size, This const&, std::allocator_arg_t, Alloc const& alloc, Args const&...)
+    {
+        return allocate(size, alloc);
+    }
+
+    // GCC pairs the allocator_arg operator new overloads with a placement operator delete, and at -O0 warns
+    // (-Wmismatched-new-delete) where the coroutine releases its frame with this one, the only deallocation function
+    // a coroutine frame uses; inlined, the call it checks is gone
+#if defined(__GNUC__) && !defined(__clang__)
+    [[gnu::always_inline]]
+#endif
+    static void operator delete(void* frame, std::size_t size) noexcept
+    {
+        auto fn = *std::launder(reinterpret_cast<deallocate_fn*>(static_cast<std::byte*>(frame) + function_offset(size)));
+        fn(frame, size);
+    }
+};
+
+#endif // FRAME_ALLOCATOR_H
@@ -0,0 +1,191 @@
+#ifndef FUTURE_WAITER_H
+#define FUTURE_WAITER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Shared service that resumes the coroutines awaiting a std::future.
+// std::future has no continuation hook: somebody must block on it. Instead of a thread per co_await a bounded set of
+// waiter threads multiplexes all the pending futures. Each waiter resumes the coroutines whose futures are ready and
+// otherwise blocks on its oldest pending future with an increasing timeout (up to max_backoff).
+// The coroutines are resumed on the waiter threads.
+class future_waiter
+{
+public:
+    // Intrusive list node kept into the awaiter (in the coroutine frame): submitting a wait doesn't allocate.
+    struct wait_node
+    {
+        wait_node* next = nullptr;
+        std::coroutine_handle<> continuation;
+
+        // true if the awaited future is ready (or deferred) within the timeout
+        virtual bool ready_within(std::chrono::microseconds timeout) const = 0;
+
+    protected:
+        ~wait_node() = default;
+    };
+
+    static constexpr std::chrono::microseconds max_backoff{1000};
+
+private:
+    struct waiter
+    {
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        wait_node* incoming = nullptr;
+        bool stop = false;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<waiter>> waiters_;
+    std::atomic<std::size_t> next_{0};
+
+    static void run(waiter& w)
+    {
+        std::vector<wait_node*> pending;
+        std::chrono::microseconds backoff{0};
+
+        for (;;)
+        {
+            {
+                std::unique_lock lock(w.mutex);
+                if (pending.empty())
+                    w.wakeup.wait(lock, [&w] { return w.stop || w.incoming; });
+
+                if (w.stop)
+                    return;
+
+                // incoming is a stack, keep the submission order
+                auto first = pending.size();
+                for (auto node = std::exchange(w.incoming, nullptr); node; node = node->next)
+                    pending.push_back(node);
+                std::reverse(pending.begin() + first, pending.end());
+            }
+
+            // resume the ready ones, compacting the others
+            auto kept = pending.begin();
+            for (auto node : pending)
+            {
+                if (node->ready_within(std::chrono::microseconds{0}))
+                    node->continuation.resume(); // the node is destroyed with the awaiter
+                else
+                    *kept++ = node;
+            }
+
+            if (kept != pending.end())
+            {
+                pending.erase(kept, pending.end());
+                backoff = std::chrono::microseconds{0};
+                continue;
+            }
+
+            // nothing ready: block on the oldest one for a while
+            backoff = std::clamp(backoff * 2, std::chrono::microseconds{1}, max_backoff);
+            pending.front()->ready_within(backoff);
+        }
+    }
+
+public:
+    future_waiter(future_waiter const&) = delete;
+    future_waiter& operator=(future_waiter const&) = delete;
+
+    explicit future_waiter(unsigned threads = 1)
+    {
+        threads = std::max(threads, 1u);
+
+        for (unsigned i = 0; i < threads; ++i)
+            waiters_.push_back(std::make_unique<waiter>());
+
+        for (auto& w : waiters_)
+            w->thread = std::thread(&future_waiter::run, std::ref(*w));
+    }
+
+    // pending coroutines are not resumed
+    ~future_waiter()
+    {
+        for (auto& w : waiters_)
+        {
+            {
+                std::lock_guard lock(w->mutex);
+                w->stop = true;
+            }
+            w->wakeup.notify_one();
+        }
+
+        for (auto& w : waiters_)
+            w->thread.join();
+    }
+
+    // process wide instance
+    static future_waiter& shared()
+    {
+        static future_waiter instance(std::max(std::thread::hardware_concurrency() / 4, 1u));
+        return instance;
+    }
+
+    unsigned size() const noexcept
+    {
+        return static_cast<unsigned>(waiters_.size());
+    }
+
+    // waits are spread round robin among the waiters
+    void submit(wait_node& node)
+    {
+        auto& w = *waiters_[next_.fetch_add(1, std::memory_order_relaxed) % waiters_.size()];
+        {
+            std::lock_guard lock(w.mutex);
+            node.next = w.incoming;
+            w.incoming = &node;
+        }
+        w.wakeup.notify_one();
+    }
+
+    template <typename T>
+    struct awaiter : std::future<T>, wait_node
+    {
+        future_waiter& service;
+
+        awaiter(std::future<T>&& future, future_waiter& service) noexcept
+            : std::future<T>(std::move(future))
+            , service(service)
+        {
+        }
+
+        bool ready_within(std::chrono::microseconds timeout) const override
+        {
+            return this->wait_for(timeout) != std::future_status::timeout;
+        }
+
+        // ready or deferred (std::launch::deferred) futures run as a plain continuation: no suspension
+        bool await_ready() const
+        {
+            return ready_within(std::chrono::microseconds{0});
+        }
+
+        void await_suspend(std::coroutine_handle<> cont)
+        {
+            continuation = cont;
+            service.submit(*this);
+        }
+
+        T await_resume() { return this->get(); }
+    };
+
+    template <typename T>
+    awaiter<T> await(std::future<T> future) noexcept
+    {
+        return awaiter<T>{std::move(future), *this};
+    }
+};
+
+#endif // FUTURE_WAITER_H
@@ -0,0 +1,189 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#include <frame_allocator.h>
+
+// A generator coroutine may announce how many elements it will yield:
+//   co_await size_hint{n};
+// consumers use it to pre-size storage (see collect()).
+struct size_hint
+{
+    std::size_t size;
+};
+
+// Generator introduced in yield3.cpp shared by the later examples.
+// The promise derives from frame_allocator_promise, thus the coroutines can take
+// `std::allocator_arg_t, Alloc` as leading arguments to choose the frame memory.
+// It models std::ranges::input_range and std::ranges::view (begin() + default sentinel).
+template <typename T>
+struct generator : std::ranges::view_base
+{
+    struct promise_type; // this type must be public for coroutine_traits to work it out
+
+private:
+
+    std::coroutine_handle<promise_type> _handle;
+
+public:
+
+    generator(generator const&) = delete;
+    generator(generator&& rhs) noexcept
+        : _handle(rhs._handle)
+    {
+        rhs._handle = nullptr;
+    }
+    generator& operator=(generator&& rhs) noexcept
+    {
+        if (&rhs != this)
+        {
+            if (_handle)
+                _handle.destroy();
+            _handle = rhs._handle;
+            rhs._handle = nullptr;
+        }
+
+        return *this;
+    }
+    explicit generator(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+    ~generator()
+    {
+        if (_handle)
+            _handle.destroy();
+    }
+
+    // generator<const T&> yields references to objects that outlive the suspension
+    using value_type = std::remove_cvref_t<T>;
+    using reference = std::conditional_t<std::is_reference_v<T>, T, const T&>;
+
+    struct promise_type : frame_allocator_promise
+    {
+        std::conditional_t<std::is_reference_v<T>, std::add_pointer_t<T>, T> _current_value;
+        std::optional<std::size_t> _size_hint;
+
+        std::suspend_always yield_value(T value)
+        {
+            if constexpr (std::is_reference_v<T>)
+                _current_value = std::addressof(value);
+            else
+                _current_value = std::move(value);
+            return {};
+        }
+
+        reference current_value() const noexcept
+        {
+            if constexpr (std::is_reference_v<T>)
+                return *_current_value;
+            else
+                return _current_value;
+        }
+
+        std::suspend_always initial_suspend() { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        generator get_return_object()
+        {
+            return generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        void unhandled_exception() { std::terminate(); }
+        void return_void() {}
+
+        // generators cannot co_await anything but the size hint
+        std::suspend_never await_transform(size_hint hint) noexcept
+        {
+            _size_hint = hint.size;
+            return {};
+        }
+    };
+
+    struct iterator
+    {
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = generator::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = std::add_pointer_t<generator::reference>;
+        using reference         = generator::reference;
+
+        std::coroutine_handle<promise_type> _coro = nullptr;
+
+        iterator() = default;
+        explicit iterator(std::coroutine_handle<promise_type> coro) : _coro(coro) {}
+
+        iterator& operator++()
+        {
+            _coro.resume();
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        // the coroutine state tells when we are done, no need to compare iterators
+        bool operator==(std::default_sentinel_t) const
+        {
+            return !_coro || _coro.done();
+        }
+
+        reference operator*() const
+        {
+            return _coro.promise().current_value();
+        }
+
+        pointer operator->() const
+        {
+            return std::addressof(operator*());
+        }
+    };
+
+    iterator begin()
+    {
+        _handle.resume();
+        return iterator{_handle};
+    }
+
+    std::default_sentinel_t end() const noexcept
+    {
+        return {};
+    }
+
+    // Number of elements the coroutine announced via co_await size_hint{n}.
+    // The generator is lazy: the hint is only known once begin() has been called.
+    std::optional<std::size_t> reserve_hint() const noexcept
+    {
+        return _handle ? _handle.promise()._size_hint : std::nullopt;
+    }
+};
+
+// Collects a generator into a container (like C++23 std::ranges::to).
+// The storage is pre-sized if the generator provides a size hint.
+template <typename Container, typename T>
+Container collect(generator<T> g)
+{
+    Container c;
+
+    auto it = g.begin();
+
+    if constexpr (requires { c.reserve(std::size_t{}); })
+    {
+        if (auto hint = g.reserve_hint())
+            c.reserve(*hint);
+    }
+
+    for (; it != g.end(); ++it)
+        c.insert(c.end(), *it);
+
+    return c;
+}
+
+#endif // GENERATOR_H
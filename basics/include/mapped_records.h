@@ -0,0 +1,138 @@
+#ifndef MAPPED_RECORDS_H
+#define MAPPED_RECORDS_H
+
+// POSIX only: relies on mmap/madvise
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <generator.h>
+
+// RAII read-only file mapping
+class mapped_file
+{
+    mapped_file(mapped_file const &) = delete;
+    mapped_file & operator=(mapped_file const &) = delete;
+    mapped_file & operator=(mapped_file &&) = delete;
+
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    [[noreturn]] static void throw_errno(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+public:
+
+    explicit mapped_file(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw_errno("open");
+
+        struct stat st;
+        if (::fstat(fd, &st) < 0)
+        {
+            ::close(fd);
+            throw_errno("fstat");
+        }
+
+        size_ = static_cast<std::size_t>(st.st_size);
+
+        if (size_ > 0)
+        {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                ::close(fd);
+                throw_errno("mmap");
+            }
+            data_ = static_cast<const std::byte*>(p);
+
+            // Hints are best effort: the file is scanned once from start to end
+            // (aggressive read-ahead, pages dropped behind) and large pages reduce TLB misses.
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+            ::madvise(p, size_, MADV_HUGEPAGE);
+#endif
+        }
+
+        // the mapping keeps its own reference to the file
+        ::close(fd);
+    }
+
+    // moved into the generator frames
+    mapped_file(mapped_file&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0)) {}
+
+    ~mapped_file()
+    {
+        if (data_)
+            ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+
+    const std::byte* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+};
+
+// Yields the delimited records of a mapped file as views into the mapping (no copies).
+// The views remain valid while the generator is alive (the frame keeps the mapping).
+inline generator<std::string_view> mapped_records(mapped_file file, char delimiter)
+{
+    std::string_view content(reinterpret_cast<const char*>(file.data()), file.size());
+
+    while (!content.empty())
+    {
+        auto pos = content.find(delimiter);
+        if (pos == std::string_view::npos)
+            pos = content.size();
+
+        co_yield content.substr(0, pos);
+
+        content.remove_prefix(pos == content.size() ? pos : pos + 1);
+    }
+}
+
+// Same for a file path. The file is mapped before the generator is created: an error throws std::system_error to
+// the caller, where the generator body could only terminate (see generator.h unhandled_exception)
+inline generator<std::string_view> mapped_records(const std::string& path, char delimiter)
+{
+    return mapped_records(mapped_file(path), delimiter);
+}
+
+// Yields the fixed size records (sizeof(T)) of a mapped file in place (no copies).
+// A trailing partial record is ignored.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+generator<const T&> mapped_records(mapped_file file)
+{
+    // the mapping is page aligned and sizeof(T) a multiple of alignof(T)
+    auto first = reinterpret_cast<const T*>(file.data());
+    auto last = first + file.size() / sizeof(T);
+
+    co_await size_hint{static_cast<std::size_t>(last - first)};
+
+    for (; first != last; ++first)
+        co_yield *first;
+}
+
+// Same for a file path, mapped before the generator is created
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+generator<const T&> mapped_records(const std::string& path)
+{
+    return mapped_records<T>(mapped_file(path));
+}
+
+#endif // MAPPED_RECORDS_H
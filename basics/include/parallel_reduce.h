@@ -0,0 +1,219 @@
+#ifndef PARALLEL_REDUCE_H
+#define PARALLEL_REDUCE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Minimal work-stealing pool for a known set of tasks (indexes).
+// Each worker owns a deque filled with a contiguous slice of the indexes. Workers pop
+// from the front of their own deque and, once empty, steal from the back of the others.
+// The calling thread works too, thus a pool of N threads only spawns N-1.
+class work_stealing_pool
+{
+    work_stealing_pool(work_stealing_pool const &) = delete;
+    work_stealing_pool & operator=(work_stealing_pool const &) = delete;
+
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    std::function<void(std::size_t)> job_;
+    std::size_t generation_ = 0;
+    unsigned running_ = 0;
+    bool stop_ = false;
+
+    std::atomic<std::size_t> steals_{0};
+
+    bool pop(unsigned self, std::size_t& task)
+    {
+        {
+            auto& own = *queues_[self];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        // steal from the other workers
+        for (std::size_t i = 1; i < queues_.size(); ++i)
+        {
+            auto& victim = *queues_[(self + i) % queues_.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void drain(unsigned self)
+    {
+        std::size_t task;
+        while (pop(self, task))
+            job_(task);
+
+        std::lock_guard lock(mutex_);
+        if (--running_ == 0)
+            done_.notify_all();
+    }
+
+    void worker(unsigned self)
+    {
+        std::size_t seen = 0;
+
+        for (;;)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                start_.wait(lock, [&]{ return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+            }
+
+            drain(self);
+        }
+    }
+
+public:
+
+    explicit work_stealing_pool(unsigned threads)
+    {
+        if (threads == 0)
+            threads = 1;
+
+        for (unsigned i = 0; i < threads; ++i)
+            queues_.push_back(std::make_unique<worker_queue>());
+
+        for (unsigned i = 1; i < threads; ++i)
+            threads_.emplace_back(&work_stealing_pool::worker, this, i);
+    }
+
+    ~work_stealing_pool()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    unsigned size() const noexcept
+    {
+        return static_cast<unsigned>(queues_.size());
+    }
+
+    std::size_t steals() const noexcept
+    {
+        return steals_.load(std::memory_order_relaxed);
+    }
+
+    // Runs task(i) for every i in [0, count) and waits for completion.
+    template <typename Task>
+    void for_each_index(std::size_t count, Task&& task)
+    {
+        // deal contiguous slices to keep neighbour tasks on the same worker
+        for (std::size_t w = 0; w < queues_.size(); ++w)
+        {
+            auto& q = *queues_[w];
+            std::lock_guard lock(q.mutex);
+            for (std::size_t i = count * w / queues_.size(); i < count * (w + 1) / queues_.size(); ++i)
+                q.tasks.push_back(i);
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            job_ = std::ref(task);
+            running_ = size();
+            ++generation_;
+        }
+        start_.notify_all();
+
+        drain(0);
+
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [&]{ return running_ == 0; });
+        job_ = nullptr;
+    }
+};
+
+// Splits [range.first, range.second) into partitions, builds an independent generator pipeline
+// for each one calling factory(first, last) and folds its values with op on the pool.
+// Every partition and the final combination start from identity, thus identity must be the
+// identity element of op (0 for a sum, 1 for a product, the largest value for a min).
+// The partial results are combined in partition order, thus op needs to be associative but
+// not commutative.
+template <typename Factory, typename T, typename Init, typename Op>
+auto parallel_reduce(Factory&& factory,
+                     std::pair<T, T> range,
+                     Init identity,
+                     Op op,
+                     work_stealing_pool& pool,
+                     std::size_t partitions = 0)
+{
+    using result_type = typename std::invoke_result_t<Factory&, T, T>::iterator::value_type;
+
+    const auto [first, last] = range;
+    const std::size_t size = last > first ? static_cast<std::size_t>(last - first) : 0;
+
+    if (partitions == 0)
+        partitions = pool.size() * 8; // leave room for stealing
+    if (partitions > size)
+        partitions = size ? size : 1;
+
+    std::vector<result_type> partial(partitions, identity);
+
+    pool.for_each_index(partitions, [&](std::size_t i)
+    {
+        auto pipeline = factory(static_cast<T>(first + size * i / partitions),
+                                static_cast<T>(first + size * (i + 1) / partitions));
+
+        result_type acc = identity;
+        for (auto&& v : pipeline)
+            acc = op(acc, v);
+        partial[i] = acc;
+    });
+
+    result_type result = identity;
+    for (auto& p : partial)
+        result = op(result, p);
+
+    return result;
+}
+
+template <typename Factory, typename T, typename Init, typename Op>
+auto parallel_reduce(Factory&& factory, std::pair<T, T> range, Init identity, Op op, unsigned threads)
+{
+    work_stealing_pool pool(threads);
+    return parallel_reduce(std::forward<Factory>(factory), range, identity, op, pool);
+}
+
+#endif // PARALLEL_REDUCE_H
@@ -0,0 +1,109 @@
+// > cl /EHsc /std:c++20 /O2 /I ..\include .\yield4.cpp
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+
+#include <generator.h>
+
+using namespace std;
+
+// Same pipeline stages as yield3.cpp but taking an allocator as leading argument.
+// The promise type operator new will receive it and allocate the frame from it.
+
+template <typename T, typename Alloc>
+generator<T> seq(allocator_arg_t, Alloc const&) noexcept
+{
+    for (T i = {};; ++i)
+        co_yield i;
+}
+
+template <typename T, typename Alloc>
+generator<T> take_until(allocator_arg_t, Alloc const&, generator<T>& g, T limit) noexcept
+{
+    for (auto&& v: g)
+        if (v < limit)
+            co_yield v;
+        else
+            break;
+}
+
+template <typename T, typename Alloc>
+generator<T> multiply(allocator_arg_t, Alloc const&, generator<T>& g, T factor) noexcept
+{
+    for (auto&& v: g)
+        co_yield v * factor;
+}
+
+template <typename T, typename Alloc>
+generator<T> add(allocator_arg_t, Alloc const&, generator<T>& g, T addend) noexcept
+{
+    for (auto&& v: g)
+        co_yield v + addend;
+}
+
+// A short-lived pipeline: four coroutine frames created and destroyed per call
+template <typename Alloc>
+int pipeline(Alloc const& alloc, int limit)
+{
+    auto s = seq<int>(allocator_arg, alloc);
+    auto t = take_until(allocator_arg, alloc, s, limit);
+    auto m = multiply(allocator_arg, alloc, t, 2);
+    auto a = add(allocator_arg, alloc, m, 110);
+
+    int sum = 0;
+    for (auto v : a)
+        sum += v;
+
+    return sum;
+}
+
+template <typename Create>
+void measure(const char* name, size_t iterations, Create&& create)
+{
+    auto start = chrono::steady_clock::now();
+
+    long long total = 0;
+    for (size_t i = 0; i < iterations; ++i)
+        total += create();
+
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+
+    cout << name << ": " << elapsed.count() / iterations << " ns/pipeline"
+         << " (checksum " << total << ")" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = argc > 1 ? atoi(argv[1]) : 1'000'000;
+    const int limit = 10;
+
+    cout << iterations << " pipelines of 4 generators yielding " << limit << " values" << endl;
+
+    // global heap
+    measure("heap", iterations, [&]
+    {
+        return pipeline(allocator<byte>{}, limit);
+    });
+
+    // recycles the frames released by the previous pipeline
+    pmr::unsynchronized_pool_resource pool;
+    measure("pool", iterations, [&]
+    {
+        return pipeline(pmr::polymorphic_allocator<byte>{&pool}, limit);
+    });
+
+    // arena on the stack: pointer bump allocation, everything released at once
+    alignas(max_align_t) array<byte, 4096> buffer;
+    measure("arena", iterations, [&]
+    {
+        pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size(), pmr::null_memory_resource()};
+        return pipeline(pmr::polymorphic_allocator<byte>{&arena}, limit);
+    });
+
+    return 0;
+}
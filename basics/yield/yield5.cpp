@@ -0,0 +1,94 @@
+// > cl /EHsc /std:c++20 /O2 /I ..\include .\yield5.cpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+#include <generator.h>
+#include <parallel_reduce.h>
+
+using namespace std;
+
+// Unlike yield3.cpp the stages take the upstream generator by value. The coroutine frame
+// keeps it alive, thus a whole pipeline can be returned from a function and processed
+// elsewhere (another thread).
+
+template <typename T>
+generator<T> seq(T first, T last) noexcept
+{
+    for (T i = first; i < last; ++i)
+        co_yield i;
+}
+
+// CPU-heavy stage: trial division
+template <typename T>
+generator<T> primes(generator<T> g) noexcept
+{
+    for (auto&& v: g)
+    {
+        bool prime = v > 1;
+        for (T d = 2; prime && d * d <= v; ++d)
+            prime = v % d != 0;
+
+        if (prime)
+            co_yield v;
+    }
+}
+
+template <typename T>
+generator<T> multiply(generator<T> g, T factor) noexcept
+{
+    for (auto&& v: g)
+        co_yield v * factor;
+}
+
+template <typename T>
+generator<T> add(generator<T> g, T addend) noexcept
+{
+    for (auto&& v: g)
+        co_yield v + addend;
+}
+
+int main(int argc, char* argv[])
+{
+    long long limit = argc > 1 ? atoll(argv[1]) : 20'000'000;
+    unsigned max_threads = argc > 2 ? atoi(argv[2]) : thread::hardware_concurrency();
+    if (max_threads == 0)
+        max_threads = 1;
+
+    // each partition gets its own pipeline
+    auto factory = [](long long first, long long last)
+    {
+        return add(multiply(primes(seq(first, last)), 2ll), 110ll);
+    };
+
+    auto sum = [](long long a, long long b) { return a + b; };
+
+    cout << "sum of 2*p+110 for primes p below " << limit << endl;
+
+    double single = 0;
+    for (unsigned threads = 1;; threads = min(threads * 2, max_threads))
+    {
+        work_stealing_pool pool(threads);
+
+        auto start = chrono::steady_clock::now();
+        auto result = parallel_reduce(factory, pair{0ll, limit}, 0ll, sum, pool);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+        if (threads == 1)
+            single = elapsed.count();
+
+        cout << threads << " threads: " << elapsed.count() << " s"
+             << " speedup " << single / elapsed.count()
+             << " steals " << pool.steals()
+             << " (result " << result << ")" << endl;
+
+        if (threads == max_threads)
+            break;
+    }
+
+    return 0;
+}
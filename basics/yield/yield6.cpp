@@ -0,0 +1,104 @@
+// > cl /EHsc /std:c++20 /O2 /I ..\include .\yield6.cpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <ranges>
+#include <vector>
+
+#include <generator.h>
+
+using namespace std;
+
+// The generator models std::ranges::input_range, check it
+static_assert(ranges::input_range<generator<int>>);
+static_assert(ranges::view<generator<int>>);
+
+// Announces the number of elements to the consumer
+template <typename T>
+generator<T> iota(T first, T last) noexcept
+{
+    co_await size_hint{static_cast<size_t>(last - first)};
+
+    for (T i = first; i < last; ++i)
+        co_yield i;
+}
+
+// Same without hint
+template <typename T>
+generator<T> iota_unsized(T first, T last) noexcept
+{
+    for (T i = first; i < last; ++i)
+        co_yield i;
+}
+
+// A stage that forwards the upstream hint (one to one transformation)
+template <typename T>
+generator<T> multiply(generator<T> g, T factor) noexcept
+{
+    auto it = g.begin();
+
+    if (auto hint = g.reserve_hint())
+        co_await size_hint{*hint};
+
+    for (; it != g.end(); ++it)
+        co_yield *it * factor;
+}
+
+template <typename Collect>
+void measure(const char* name, Collect&& collect)
+{
+    auto start = chrono::steady_clock::now();
+    vector<int> v = collect();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    cout << name << ": " << elapsed.count() << " s "
+         << v.size() << " elements (capacity " << v.capacity() << ")" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 100'000'000;
+
+    // std::ranges algorithms and views work on generators
+    auto numbers = iota(0, 100);
+    auto found = ranges::find_if(numbers, [](int i) { return i * i > 200; });
+    cout << "first square above 200: " << *found << endl;
+
+    for (int i : iota(0, 20)
+                 | views::filter([](int i) { return i % 3 == 0; })
+                 | views::transform([](int i) { return i * 10; }))
+        cout << i << ' ';
+    cout << endl;
+
+    cout << "collecting " << count << " elements" << endl;
+
+    measure("push_back without hint", [&]
+    {
+        vector<int> v;
+        for (int i : iota_unsized(0, count))
+            v.push_back(i);
+        return v;
+    });
+
+    measure("ranges::copy into back_inserter", [&]
+    {
+        vector<int> v;
+        ranges::copy(iota_unsized(0, count), back_inserter(v));
+        return v;
+    });
+
+    measure("collect with hint", [&]
+    {
+        return collect<vector<int>>(iota(0, count));
+    });
+
+    measure("collect with forwarded hint", [&]
+    {
+        return collect<vector<int>>(multiply(iota(0, count), 2));
+    });
+
+    return 0;
+}
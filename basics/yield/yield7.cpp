@@ -0,0 +1,155 @@
+// > g++ -std=c++20 -O2 -I ../include yield7.cpp
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <generator.h>
+#include <mapped_records.h>
+
+using namespace std;
+
+// yield3.cpp style stages fed by the file records
+
+template <typename T>
+generator<T> take_until(generator<T>& g, T limit) noexcept
+{
+    for (auto&& v: g)
+        if (v < limit)
+            co_yield v;
+        else
+            break;
+}
+
+template <typename T, typename U, typename F>
+generator<T> transform(generator<U>& g, F f) noexcept
+{
+    for (auto&& v: g)
+        co_yield f(v);
+}
+
+long long parse(string_view s) noexcept
+{
+    long long value = 0;
+    from_chars(s.data(), s.data() + s.size(), value);
+    return value;
+}
+
+struct sample
+{
+    uint64_t id;
+    double value;
+};
+
+void create_text_file(const string& path, size_t megabytes)
+{
+    cout << "creating " << megabytes << " MB file " << path << endl;
+
+    ofstream out(path, ios::binary);
+    string chunk;
+    size_t written = 0;
+    for (uint64_t i = 0; written < megabytes << 20; ++i)
+    {
+        chunk += to_string((i * 7919) % 1'000'000'007);
+        chunk += '\n';
+
+        if (chunk.size() > 1 << 20)
+        {
+            out.write(chunk.data(), chunk.size());
+            written += chunk.size();
+            chunk.clear();
+        }
+    }
+    out.write(chunk.data(), chunk.size());
+}
+
+void create_binary_file(const string& path, size_t count)
+{
+    ofstream out(path, ios::binary);
+    for (size_t i = 0; i < count; ++i)
+    {
+        sample s{i, i * 0.5};
+        out.write(reinterpret_cast<const char*>(&s), sizeof(s));
+    }
+}
+
+template <typename Read>
+void measure(const char* name, uintmax_t bytes, Read&& read)
+{
+    auto start = chrono::steady_clock::now();
+    auto [lines, sum] = read();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    cout << name << ": " << elapsed.count() << " s "
+         << bytes / elapsed.count() / (1 << 20) << " MB/s "
+         << lines << " records (sum " << sum << ")" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: yield7 <file> [<megabytes>]" << endl;
+        return 1;
+    }
+
+    string path = argv[1];
+    size_t megabytes = argc > 2 ? atoi(argv[2]) : 4096;
+    const long long limit = 1'000'000'007;
+
+    if (!filesystem::exists(path))
+        create_text_file(path, megabytes);
+
+    auto bytes = filesystem::file_size(path);
+
+    // note the first run warms up the page cache
+    measure("ifstream getline", bytes, [&]
+    {
+        ifstream in(path);
+        string line;
+        long long lines = 0, sum = 0;
+        while (getline(in, line))
+        {
+            auto v = parse(line);
+            if (v >= limit)
+                break;
+            ++lines;
+            sum += v;
+        }
+        return pair{lines, sum};
+    });
+
+    measure("mapped_records", bytes, [&]
+    {
+        auto records = mapped_records(path, '\n');
+        auto values = transform<long long>(records, parse);
+        auto taken = take_until(values, limit);
+
+        long long lines = 0, sum = 0;
+        for (auto v : taken)
+        {
+            ++lines;
+            sum += v;
+        }
+        return pair{lines, sum};
+    });
+
+    // fixed size records are yielded in place
+    string binary = path + ".bin";
+    create_binary_file(binary, 1'000'000);
+
+    double total = 0;
+    for (const sample& s : mapped_records<sample>(binary))
+        total += s.value;
+    cout << "binary records sum " << total << endl;
+
+    filesystem::remove(binary);
+
+    return 0;
+}
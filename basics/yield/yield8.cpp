@@ -0,0 +1,112 @@
+// > cl /EHsc /std:c++20 /O2 /I ..\include .\yield8.cpp
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <combinators.h>
+#include <generator.h>
+
+using namespace std;
+
+// sorted sequence with pseudo-random gaps
+generator<uint64_t> sorted(uint64_t seed, size_t count) noexcept
+{
+    uint64_t value = seed;
+    for (size_t i = 0; i < count; ++i)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        value += (seed >> 59) + 1;
+        co_yield value;
+    }
+}
+
+// naive merge: scans all the inputs for the minimum
+generator<uint64_t> linear_merge(vector<generator<uint64_t>> sources)
+{
+    vector<generator<uint64_t>::iterator> heads;
+    for (auto& s : sources)
+        heads.push_back(s.begin());
+
+    for (;;)
+    {
+        size_t min = heads.size();
+        for (size_t i = 0; i < heads.size(); ++i)
+            if (heads[i] != default_sentinel && (min == heads.size() || *heads[i] < *heads[min]))
+                min = i;
+
+        if (min == heads.size())
+            break;
+
+        co_yield *heads[min];
+        ++heads[min];
+    }
+}
+
+generator<string> names()
+{
+    for (auto n : {"one", "two", "three"})
+        co_yield n;
+}
+
+generator<int> range(int first, int last)
+{
+    for (int i = first; i < last; ++i)
+        co_yield i;
+}
+
+template <typename Merge>
+void measure(const char* name, size_t sources, size_t count, Merge&& merge)
+{
+    vector<generator<uint64_t>> inputs;
+    for (size_t i = 0; i < sources; ++i)
+        inputs.push_back(sorted(i, count));
+
+    auto start = chrono::steady_clock::now();
+
+    size_t elements = 0;
+    bool ordered = true;
+    uint64_t last = 0;
+    for (auto v : merge(std::move(inputs)))
+    {
+        ordered = ordered && last <= v;
+        last = v;
+        ++elements;
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    cout << name << ": " << elapsed.count() << " s "
+         << elements / elapsed.count() / 1e6 << " M elements/s "
+         << (ordered ? "sorted" : "NOT SORTED") << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t sources = argc > 1 ? atoi(argv[1]) : 64;
+    size_t count = argc > 2 ? atoi(argv[2]) : 10'000'000;
+
+    // combinators on small inputs
+    for (auto [name, number] : zip(names(), range(1, 10)))
+        cout << name << '=' << number << ' ';
+    cout << endl;
+
+    for (auto i : interleave(range(0, 3), range(10, 15), range(20, 22)))
+        cout << i << ' ';
+    cout << endl;
+
+    for (auto i : merge(range(0, 10), range(5, 8), range(3, 4)))
+        cout << i << ' ';
+    cout << endl;
+
+    cout << "merging " << sources << " sorted generators of " << count << " elements" << endl;
+
+    measure("heap merge", sources, count, [](auto inputs) { return merge(std::move(inputs)); });
+    measure("linear merge", sources, count, [](auto inputs) { return linear_merge(std::move(inputs)); });
+
+    return 0;
+}